@@ -0,0 +1,105 @@
+#include "analyze.hpp"
+#include "position.hpp"
+#include "repetition_info.hpp"
+#include "search.hpp"
+#include "util/types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace Clockwork {
+namespace Analyze {
+
+void analyze(const std::string& path, const AnalyzeOptions& options) {
+    std::ifstream file{path};
+    if (!file) {
+        std::cout << "Could not open file: " << path << std::endl;
+        return;
+    }
+
+    std::vector<std::string> fens;
+    std::string              line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            fens.push_back(line);
+        }
+    }
+
+    std::ofstream output_file;
+    std::ostream* output = &std::cout;
+    if (!options.output.empty()) {
+        output_file.open(options.output);
+        if (!output_file) {
+            std::cout << "Could not open file: " << options.output << std::endl;
+            return;
+        }
+        output = &output_file;
+    }
+
+    std::mutex         output_mutex;
+    std::atomic<usize> next_fen{0};
+    std::atomic<u64>   total_nodes{0};
+
+    auto analyze_fens = [&] {
+        Search::Searcher searcher;
+        searcher.initialize(1);
+        searcher.resize_tt(options.hash_mb);
+
+        Search::SearchSettings settings = {
+          .depth = options.depth, .hard_nodes = options.nodes, .silent = true};
+
+        for (usize i = next_fen.fetch_add(1); i < fens.size(); i = next_fen.fetch_add(1)) {
+            std::ostringstream result_line;
+
+            if (auto pos = Position::parse(fens[i])) {
+                RepetitionInfo repetition_info;
+                repetition_info.push(pos->get_hash_key(), false);
+
+                // Start every position from scratch, so results do not depend on which thread
+                // happened to search what before
+                searcher.reset();
+                searcher.set_position(*pos, repetition_info);
+                searcher.launch_search(settings);
+                Search::SearchResult result = searcher.wait_for_result();
+                u64                  nodes  = searcher.node_count();
+                total_nodes.fetch_add(nodes, std::memory_order_relaxed);
+
+                result_line << i << " fen " << fens[i] << " bestmove " << result.best_move
+                            << " score " << Search::uci_score(result.score) << " depth "
+                            << result.depth << " seldepth " << result.seldepth << " nodes "
+                            << nodes << " pv " << result.pv;
+            } else {
+                result_line << i << " fen " << fens[i] << " invalid";
+            }
+
+            std::lock_guard lock{output_mutex};
+            *output << result_line.str() << std::endl;
+        }
+    };
+
+    auto start_time = time::Clock::now();
+
+    std::vector<std::thread> threads;
+    for (usize t = 0; t < std::max<usize>(1, options.threads); t++) {
+        threads.emplace_back(analyze_fens);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto elapsed = time::Clock::now() - start_time;
+    std::cout << "Analyzed " << fens.size() << " positions in "
+              << time::cast<time::Milliseconds>(elapsed).count() << " ms ("
+              << time::nps(total_nodes.load(), elapsed) << " nps)" << std::endl;
+}
+
+}  // namespace Analyze
+}  // namespace Clockwork
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "util/types.hpp"
+#include <string>
+
+namespace Clockwork {
+namespace Analyze {
+
+struct AnalyzeOptions {
+    u64         nodes   = 0;
+    Depth       depth   = 0;
+    usize       threads = 1;
+    usize       hash_mb = 16;
+    std::string output;  // Results go to stdout when empty
+};
+
+// Searches every FEN in a file, one position per thread, each thread with its own single-threaded
+// searcher and small TT. Results are written as soon as each search completes.
+void analyze(const std::string& path, const AnalyzeOptions& options);
+
+}  // namespace Analyze
+}  // namespace Clockwork
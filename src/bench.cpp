@@ -5,7 +5,14 @@
 #include "util/types.hpp"
 #include <array>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef __linux__
+    #include <unistd.h>
+#endif
 
 namespace Clockwork::Bench {
 const std::array<std::string, 53> BENCH_FENS = {{
@@ -64,9 +71,18 @@ const std::array<std::string, 53> BENCH_FENS = {{
   "2r2n2/8/3k4/8/8/4KN2/8/6R1 w - - 0 1",
 }};
 
-void benchmark(Search::Searcher& searcher, Depth depth) {
-    u64 nodes = 0;
+static void print_hitrate(std::string_view name, u64 hits, u64 misses) {
+    u64 probes  = hits + misses;
+    u64 hitrate = probes > 0 ? hits * 100 / probes : 0;
+    std::cout << name << ": " << hits << " hits " << misses << " misses " << hitrate
+              << "% hitrate" << std::endl;
+}
 
+// Searches every bench position to `depth`, returning the elapsed time.
+static time::Duration run_bench_fens(Search::Searcher&    searcher,
+                                     Depth                depth,
+                                     u64&                 nodes,
+                                     Search::SearchStats& stats) {
     // Mock search limits for bench
     Search::SearchSettings settings = {.depth = depth};
 
@@ -79,15 +95,81 @@ void benchmark(Search::Searcher& searcher, Depth depth) {
         searcher.launch_search(settings);
         searcher.wait();
         nodes += searcher.node_count();
+        stats += searcher.stats();
     }
+    return time::Clock::now() - start_time;
+}
+
+void benchmark(Search::Searcher& searcher, Depth depth) {
+    u64                 nodes = 0;
+    Search::SearchStats stats;
 
-    auto end_time = time::Clock::now();
+    time::Duration elapsed = run_bench_fens(searcher, depth, nodes, stats);
 
     searcher.stop_searching();
 
     dbg_print();
 
-    std::cout << nodes << " nodes " << time::nps(nodes, end_time - start_time) << " nps"
-              << std::endl;
+    print_hitrate("TT", stats.tt_hits, stats.tt_misses);
+    print_hitrate("Eval cache", stats.eval_cache_hits, stats.eval_cache_misses);
+    print_hitrate("Pawn table", stats.pawn_table_hits, stats.pawn_table_misses);
+
+    u64 psqt_skipped  = stats.psqt_deferred - stats.psqt_applied;
+    u64 psqt_skiprate = stats.psqt_deferred > 0 ? psqt_skipped * 100 / stats.psqt_deferred : 0;
+    std::cout << "Psqt updates: " << stats.psqt_deferred << " deferred " << stats.psqt_applied
+              << " applied " << psqt_skiprate << "% skipped" << std::endl;
+
+    u64 lazy_rate =
+      stats.eval_cache_misses > 0 ? stats.lazy_evals * 100 / stats.eval_cache_misses : 0;
+    std::cout << "Lazy eval: " << stats.lazy_evals << " early exits " << lazy_rate
+              << "% of evaluations" << std::endl;
+
+    std::cout << nodes << " nodes " << time::nps(nodes, elapsed) << " nps" << std::endl;
+}
+
+static usize physical_memory_mb() {
+#ifdef __linux__
+    auto pages     = sysconf(_SC_PHYS_PAGES);
+    auto page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && page_size > 0) {
+        return static_cast<usize>(pages) * static_cast<usize>(page_size) / (1024 * 1024);
+    }
+#endif
+    return std::numeric_limits<usize>::max();
+}
+
+void hash_sweep(Search::Searcher& searcher, Depth depth, std::vector<usize> sizes_mb) {
+    if (sizes_mb.empty()) {
+        sizes_mb = {16, 64, 256, 1024, 4096, 16384, 65536};
+    }
+
+    usize original_mb = searcher.tt.size_bytes() / (1024 * 1024);
+
+    std::cout << "TT layout: " << TT_BUCKET_ENTRIES << " entries per " << TT::Cluster::BYTES
+              << " byte cluster" << std::endl;
+
+    for (usize mb : sizes_mb) {
+        if (mb > physical_memory_mb()) {
+            std::cout << "Hash " << mb << " MB: skipped, larger than physical memory" << std::endl;
+            continue;
+        }
+
+        searcher.resize_tt(mb);
+        searcher.reset();
+
+        u64                 nodes = 0;
+        Search::SearchStats stats;
+        time::Duration      elapsed = run_bench_fens(searcher, depth, nodes, stats);
+
+        u64 probes  = stats.tt_hits + stats.tt_misses;
+        u64 hitrate = probes > 0 ? stats.tt_hits * 100 / probes : 0;
+        std::cout << "Hash " << mb << " MB: depth " << depth << " in "
+                  << time::cast<time::Milliseconds>(elapsed).count() << " ms, " << nodes
+                  << " nodes " << time::nps(nodes, elapsed) << " nps, " << hitrate
+                  << "% TT hitrate, hashfull " << searcher.tt.hashfull() << std::endl;
+    }
+
+    searcher.stop_searching();
+    searcher.resize_tt(original_mb);
 }
 }  // namespace Clockwork::Bench
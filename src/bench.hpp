@@ -1,10 +1,15 @@
 #include "search.hpp"
 #include "tt.hpp"
 #include "util/types.hpp"
+#include <vector>
 
 
 namespace Clockwork {
 namespace Bench {
 void benchmark(Search::Searcher& searcher, Depth depth);
+
+// Runs the bench positions at each hash size (16 MB to 64 GB by default) and reports time to
+// depth, nps and TT hit rate, for comparing TT layouts (see TT_BUCKET_ENTRIES).
+void hash_sweep(Search::Searcher& searcher, Depth depth, std::vector<usize> sizes_mb);
 }
 }  // namespace Clockwork
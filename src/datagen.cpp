@@ -0,0 +1,189 @@
+#include "datagen.hpp"
+#include "genfens.hpp"
+#include "movegen.hpp"
+#include "position.hpp"
+#include "repetition_info.hpp"
+#include "search.hpp"
+#include "util/types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace Clockwork {
+namespace Datagen {
+
+constexpr usize MAX_GAME_PLIES = 1000;
+
+// A game is adjudicated as won once the score stays this high for WIN_ADJ_PLIES plies in a row
+constexpr Value WIN_ADJ_SCORE = 2500;
+constexpr usize WIN_ADJ_PLIES = 4;
+
+// And as drawn once it stays this close to zero for DRAW_ADJ_PLIES plies after DRAW_ADJ_MIN_PLY
+constexpr Value DRAW_ADJ_SCORE   = 10;
+constexpr usize DRAW_ADJ_PLIES   = 10;
+constexpr usize DRAW_ADJ_MIN_PLY = 80;
+
+void write_game(std::ostream& os, const GameRecord& game) {
+    os.write(reinterpret_cast<const char*>(&game.start), sizeof(game.start));
+    os.write(reinterpret_cast<const char*>(game.moves.data()),
+             static_cast<std::streamsize>(game.moves.size() * sizeof(GameMove)));
+    GameMove terminator{};
+    os.write(reinterpret_cast<const char*>(&terminator), sizeof(terminator));
+}
+
+bool read_game(std::istream& is, GameRecord& game) {
+    game.moves.clear();
+    if (!is.read(reinterpret_cast<char*>(&game.start), sizeof(game.start))) {
+        return false;
+    }
+
+    GameMove move;
+    while (is.read(reinterpret_cast<char*>(&move), sizeof(move))) {
+        if (move.move == 0) {
+            return true;
+        }
+        game.moves.push_back(move);
+    }
+    return false;
+}
+
+static GameResult win_for(Color color) {
+    return color == Color::White ? GameResult::WhiteWin : GameResult::BlackWin;
+}
+
+static GameRecord play_game(Search::Searcher& searcher, const Position& opening, u64 nodes) {
+    GameRecord game;
+    Position   pos = opening;
+
+    RepetitionInfo rep_info;
+    rep_info.push(pos.get_hash_key(), false);
+
+    searcher.reset();
+
+    usize                     win_plies  = 0;
+    usize                     draw_plies = 0;
+    std::optional<GameResult> result;
+
+    while (!result) {
+        MoveList noisy, quiet;
+        MoveGen  movegen{pos};
+        movegen.generate_moves(noisy, quiet);
+        if (noisy.empty() && quiet.empty()) {
+            result = pos.is_in_check() ? win_for(invert(pos.active_color())) : GameResult::Draw;
+            break;
+        }
+        if (pos.get_50mr_counter() >= 100 || pos.is_insufficient_material()
+            || rep_info.detect_repetition(0) || game.moves.size() >= MAX_GAME_PLIES) {
+            result = GameResult::Draw;
+            break;
+        }
+
+        Search::SearchSettings settings = {.stm        = pos.active_color(),
+                                           .hard_nodes = nodes * 64,
+                                           .soft_nodes = nodes,
+                                           .silent     = true,
+                                           .datagen    = true};
+
+        searcher.set_position(pos, rep_info);
+        searcher.launch_search(settings);
+        Search::SearchResult search = searcher.wait_for_result();
+        if (search.best_move == Move::none()) {
+            result = GameResult::Draw;
+            break;
+        }
+
+        Value white_score = pos.active_color() == Color::White ? search.score : -search.score;
+        game.moves.push_back({search.best_move.raw, static_cast<i16>(white_score)});
+
+        win_plies  = std::abs(white_score) >= WIN_ADJ_SCORE ? win_plies + 1 : 0;
+        draw_plies = std::abs(white_score) <= DRAW_ADJ_SCORE ? draw_plies + 1 : 0;
+        if (win_plies >= WIN_ADJ_PLIES) {
+            result = white_score > 0 ? GameResult::WhiteWin : GameResult::BlackWin;
+        } else if (draw_plies >= DRAW_ADJ_PLIES && game.moves.size() >= DRAW_ADJ_MIN_PLY) {
+            result = GameResult::Draw;
+        }
+
+        bool reversible = pos.is_reversible(search.best_move);
+        pos             = pos.move(search.best_move);
+        rep_info.push(pos.get_hash_key(), reversible);
+    }
+
+    game.start        = opening.pack();
+    game.start.result = *result;
+    game.start.score  = game.moves.empty() ? 0 : game.moves.front().score;
+    return game;
+}
+
+void datagen(const DatagenOptions& options) {
+    std::ofstream file{options.output, std::ios::binary | std::ios::app};
+    if (!file) {
+        std::cout << "Could not open file: " << options.output << std::endl;
+        return;
+    }
+
+    std::vector<std::string> book = options.book;
+    if (book.empty()) {
+        book.push_back("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    }
+
+    std::mutex       output_mutex;
+    std::atomic<u64> next_game{0};
+    u64              games_done     = 0;
+    u64              positions_done = 0;
+
+    auto start_time = time::Clock::now();
+
+    auto play_games = [&](usize thread) {
+        Genfens::seed_thread_stream(options.seed, thread);
+
+        Search::Searcher searcher;
+        searcher.initialize(1);
+
+        std::ostringstream buffer;
+        while (next_game.fetch_add(1) < options.games) {
+            std::optional<Position> opening;
+            while (!opening) {
+                opening = Genfens::generate_opening(searcher, book, options.rand_moves);
+            }
+
+            GameRecord game = play_game(searcher, *opening, options.nodes);
+
+            buffer.str({});
+            write_game(buffer, game);
+
+            std::lock_guard lock{output_mutex};
+            file << buffer.str();
+            games_done++;
+            positions_done += game.moves.size();
+            if (games_done % 100 == 0 || games_done == options.games) {
+                auto elapsed = time::Clock::now() - start_time;
+                std::cout << "info string datagen games " << games_done << " positions "
+                          << positions_done << " time "
+                          << time::cast<time::Milliseconds>(elapsed).count() << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (usize t = 0; t < std::max<usize>(1, options.threads); t++) {
+        threads.emplace_back(play_games, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    file.flush();
+    if (!file) {
+        std::cout << "Failed writing to " << options.output << std::endl;
+    }
+}
+
+}  // namespace Datagen
+}  // namespace Clockwork
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "packed_position.hpp"
+#include "util/types.hpp"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Clockwork {
+namespace Datagen {
+
+// One ply of a game: the move played and the search score, from white's point of view
+struct GameMove {
+    u16 move  = 0;
+    i16 score = 0;
+};
+
+static_assert(sizeof(GameMove) == 4);
+
+// A game is stored as its packed start position, carrying the game result, followed by one
+// GameMove per ply and a zero GameMove as terminator.
+struct GameRecord {
+    PackedPosition        start;
+    std::vector<GameMove> moves;
+};
+
+void write_game(std::ostream& os, const GameRecord& game);
+
+// Returns false at the end of the stream or on a truncated record
+bool read_game(std::istream& is, GameRecord& game);
+
+struct DatagenOptions {
+    std::string              output;
+    u64                      games      = 0;
+    u64                      nodes      = 5000;  // Soft node limit per move
+    usize                    threads    = 1;
+    u64                      seed       = 0;
+    i32                      rand_moves = 8;
+    std::vector<std::string> book;  // Starting lines, the start position when empty
+};
+
+// Plays fixed-node self-play games from genfens-style openings on every thread and appends them to
+// `options.output`.
+void datagen(const DatagenOptions& options);
+
+}  // namespace Datagen
+}  // namespace Clockwork
@@ -0,0 +1,256 @@
+#include "endgame.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <bitset>
+#include <cstdlib>
+#include <vector>
+
+namespace Clockwork::Endgame {
+
+static constexpr Value MAX_SCORE = 2 * KNOWN_WIN;
+
+// Rough endgame piece values, only used to keep preferring material in won endgames.
+static constexpr std::array<Value, 6> PIECE_VALUES = {0, 500, 1500, 1600, 2550, 3900};
+
+static i32 distance(Square a, Square b) {
+    return std::max(std::abs(a.file() - b.file()), std::abs(a.rank() - b.rank()));
+}
+
+static i32 manhattan_distance(Square a, Square b) {
+    return std::abs(a.file() - b.file()) + std::abs(a.rank() - b.rank());
+}
+
+static i32 center_distance(Square sq) {
+    return std::max(3 - sq.file(), sq.file() - 4) + std::max(3 - sq.rank(), sq.rank() - 4);
+}
+
+// KPK bitbase, indexed by side to move, both king squares and the pawn square.
+// The strong side is white and the pawn is mirrored onto files a-d, on ranks 2-7.
+static constexpr usize KPK_SIZE = 2 * 24 * 64 * 64;
+
+static std::bitset<KPK_SIZE> kpk_bitbase;
+
+static usize kpk_index(Color stm, Square weak_king, Square strong_king, Square pawn) {
+    return static_cast<usize>(strong_king.raw) | (static_cast<usize>(weak_king.raw) << 6)
+         | (static_cast<usize>(stm) << 12) | (static_cast<usize>(pawn.file()) << 13)
+         | (static_cast<usize>(6 - pawn.rank()) << 15);
+}
+
+enum KPKResult : u8 {
+    INVALID = 0,
+    UNKNOWN = 1,
+    DRAW    = 2,
+    WIN     = 4,
+};
+
+static u64 king_attacks(Square sq) {
+    u64 result = 0;
+    for (i32 df = -1; df <= 1; df++) {
+        for (i32 dr = -1; dr <= 1; dr++) {
+            i32 file = sq.file() + df;
+            i32 rank = sq.rank() + dr;
+            if ((df || dr) && file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                result |= u64{1} << Square::from_file_and_rank(file, rank).raw;
+            }
+        }
+    }
+    return result;
+}
+
+static u64 pawn_attacks(Square sq) {
+    u64 result = 0;
+    for (i32 df : {-1, 1}) {
+        i32 file = sq.file() + df;
+        if (file >= 0 && file < 8 && sq.rank() < 7) {
+            result |= u64{1} << Square::from_file_and_rank(file, sq.rank() + 1).raw;
+        }
+    }
+    return result;
+}
+
+struct KPKPosition {
+    Color     stm;
+    Square    weak_king;
+    Square    strong_king;
+    Square    pawn;
+    KPKResult result;
+
+    explicit KPKPosition(usize idx) {
+        strong_king = Square{static_cast<u8>(idx & 0x3F)};
+        weak_king   = Square{static_cast<u8>((idx >> 6) & 0x3F)};
+        stm         = static_cast<Color>((idx >> 12) & 0x1);
+        pawn        = Square::from_file_and_rank(static_cast<i32>((idx >> 13) & 0x3),
+                                                 6 - static_cast<i32>(idx >> 15));
+
+        Square promo = Square{static_cast<u8>(pawn.raw + 8)};
+
+        u64 weak_king_bb   = u64{1} << weak_king.raw;
+        u64 pawn_bb        = u64{1} << pawn.raw;
+        u64 weak_attacks   = king_attacks(weak_king);
+        u64 strong_attacks = king_attacks(strong_king);
+
+        if (distance(strong_king, weak_king) <= 1 || strong_king == pawn || weak_king == pawn
+            || (stm == Color::White && (pawn_attacks(pawn) & weak_king_bb))) {
+            result = INVALID;
+        } else if (stm == Color::White && pawn.rank() == 6 && strong_king != promo
+                   && (distance(weak_king, promo) > 1 || distance(strong_king, promo) == 1)) {
+            // The pawn promotes safely
+            result = WIN;
+        } else if (stm == Color::Black
+                   && (!(weak_attacks & ~(strong_attacks | pawn_attacks(pawn)))
+                       || (weak_attacks & ~strong_attacks & pawn_bb))) {
+            // Stalemate, or the pawn can be captured
+            result = DRAW;
+        } else {
+            result = UNKNOWN;
+        }
+    }
+
+    KPKResult classify(const std::vector<KPKPosition>& db) {
+        const KPKResult good = stm == Color::White ? WIN : DRAW;
+        const KPKResult bad  = stm == Color::White ? DRAW : WIN;
+
+        u8 r = INVALID;
+
+        Square king = stm == Color::White ? strong_king : weak_king;
+        for (u64 moves = king_attacks(king); moves; moves &= moves - 1) {
+            Square to = Square{static_cast<u8>(std::countr_zero(moves))};
+            r |= stm == Color::White ? db[kpk_index(Color::Black, weak_king, to, pawn)].result
+                                     : db[kpk_index(Color::White, to, strong_king, pawn)].result;
+        }
+
+        if (stm == Color::White) {
+            Square single = Square{static_cast<u8>(pawn.raw + 8)};
+            if (pawn.rank() < 6) {
+                r |= db[kpk_index(Color::Black, weak_king, strong_king, single)].result;
+            }
+            Square dbl = Square{static_cast<u8>(pawn.raw + 16)};
+            if (pawn.rank() == 1 && single != strong_king && single != weak_king) {
+                r |= db[kpk_index(Color::Black, weak_king, strong_king, dbl)].result;
+            }
+        }
+
+        result = (r & good) ? good : (r & UNKNOWN) ? UNKNOWN : bad;
+        return result;
+    }
+};
+
+void init() {
+    std::vector<KPKPosition> db;
+    db.reserve(KPK_SIZE);
+
+    for (usize idx = 0; idx < KPK_SIZE; idx++) {
+        db.emplace_back(idx);
+    }
+
+    // Iterate until no unknown position can be resolved any further
+    bool repeat = true;
+    while (repeat) {
+        repeat = false;
+        for (usize idx = 0; idx < KPK_SIZE; idx++) {
+            repeat |= db[idx].result == UNKNOWN && db[idx].classify(db) != UNKNOWN;
+        }
+    }
+
+    for (usize idx = 0; idx < KPK_SIZE; idx++) {
+        kpk_bitbase[idx] = db[idx].result == WIN;
+    }
+}
+
+bool kpk_is_win(Color strong_side, Square strong_king, Square pawn, Square weak_king, Color stm) {
+    if (strong_side == Color::Black) {
+        strong_king = strong_king.flip_vertical();
+        pawn        = pawn.flip_vertical();
+        weak_king   = weak_king.flip_vertical();
+        stm         = invert(stm);
+    }
+    if (pawn.file() >= 4) {
+        strong_king = strong_king.flip_horizontal();
+        pawn        = pawn.flip_horizontal();
+        weak_king   = weak_king.flip_horizontal();
+    }
+    return kpk_bitbase[kpk_index(stm, weak_king, strong_king, pawn)];
+}
+
+Value evaluate_kpk(const Position& pos, Color strong_side) {
+    Square strong_king = pos.king_sq(strong_side);
+    Square weak_king   = pos.king_sq(invert(strong_side));
+    Square pawn        = pos.bitboard_for(strong_side, PieceType::Pawn).lsb();
+
+    if (!kpk_is_win(strong_side, strong_king, pawn, weak_king, pos.active_color())) {
+        return 0;
+    }
+    return KNOWN_WIN + PIECE_VALUES[static_cast<usize>(PieceType::Pawn)]
+         + 20 * pawn.relative_rank(strong_side);
+}
+
+Value evaluate_kbnk(const Position& pos, Color strong_side) {
+    Square strong_king = pos.king_sq(strong_side);
+    Square weak_king   = pos.king_sq(invert(strong_side));
+    Square bishop      = pos.bitboard_for(strong_side, PieceType::Bishop).lsb();
+
+    // Mate is only possible in a corner of the bishop's color
+    constexpr Square A1 = Square{0};
+    constexpr Square H1 = Square{7};
+    constexpr Square A8 = Square{56};
+    constexpr Square H8 = Square{63};
+
+    bool   dark_corners = bishop.color() == A1.color();
+    Square corner_a     = dark_corners ? A1 : H1;
+    Square corner_b     = dark_corners ? H8 : A8;
+    i32    corner_dist =
+      std::min(manhattan_distance(weak_king, corner_a), manhattan_distance(weak_king, corner_b));
+
+    return KNOWN_WIN + PIECE_VALUES[static_cast<usize>(PieceType::Knight)]
+         + PIECE_VALUES[static_cast<usize>(PieceType::Bishop)] + 40 * (14 - corner_dist)
+         + 10 * (7 - distance(strong_king, weak_king));
+}
+
+Value evaluate_kxk(const Position& pos, Color strong_side) {
+    Square strong_king = pos.king_sq(strong_side);
+    Square weak_king   = pos.king_sq(invert(strong_side));
+
+    Value material = 0;
+    for (PieceType pt : {PieceType::Pawn, PieceType::Knight, PieceType::Bishop, PieceType::Rook,
+                         PieceType::Queen}) {
+        material += PIECE_VALUES[static_cast<usize>(pt)]
+                  * material_key_count(pos.get_material_key(), strong_side, pt);
+    }
+
+    // Drive the weak king to the edge and bring our king closer
+    Value result = KNOWN_WIN + material + 50 * center_distance(weak_king)
+                 + 10 * (7 - distance(strong_king, weak_king));
+    return std::min(result, MAX_SCORE);
+}
+
+Match find(HashKey material_key) {
+    for (Color strong_side : {Color::White, Color::Black}) {
+        Color weak_side = invert(strong_side);
+
+        bool weak_is_bare = true;
+        for (PieceType pt : {PieceType::Pawn, PieceType::Knight, PieceType::Bishop,
+                             PieceType::Rook, PieceType::Queen}) {
+            weak_is_bare &= material_key_count(material_key, weak_side, pt) == 0;
+        }
+        if (!weak_is_bare) {
+            continue;
+        }
+
+        if (material_key == material_key_delta(strong_side, PieceType::Pawn)) {
+            return {evaluate_kpk, strong_side};
+        }
+        if (material_key
+            == material_key_delta(strong_side, PieceType::Knight)
+                 + material_key_delta(strong_side, PieceType::Bishop)) {
+            return {evaluate_kbnk, strong_side};
+        }
+        if (material_key_count(material_key, strong_side, PieceType::Rook) > 0
+            || material_key_count(material_key, strong_side, PieceType::Queen) > 0) {
+            return {evaluate_kxk, strong_side};
+        }
+    }
+    return {};
+}
+
+}  // namespace Clockwork::Endgame
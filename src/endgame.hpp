@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.hpp"
+#include "position.hpp"
+#include "square.hpp"
+#include "util/types.hpp"
+
+namespace Clockwork::Endgame {
+
+// Specialized evaluators bypass the regular eval for a few known material signatures.
+// They return a score from the strong side's point of view.
+using EvalFn = Value (*)(const Position& pos, Color strong_side);
+
+// Base score of a won specialized endgame. Drawn ones score 0.
+inline constexpr Value KNOWN_WIN = 10000;
+
+struct Match {
+    EvalFn fn          = nullptr;
+    Color  strong_side = Color::White;
+};
+
+// Builds the KPK bitbase.
+void init();
+
+// Look up a specialized evaluator for the given material key.
+[[nodiscard]] Match find(HashKey material_key);
+
+// Returns true if the side with the pawn wins. The strong side is normalized to white internally.
+[[nodiscard]] bool kpk_is_win(
+  Color strong_side, Square strong_king, Square pawn, Square weak_king, Color stm);
+
+// The evaluators `find` can return.
+[[nodiscard]] Value evaluate_kpk(const Position& pos, Color strong_side);
+[[nodiscard]] Value evaluate_kbnk(const Position& pos, Color strong_side);
+[[nodiscard]] Value evaluate_kxk(const Position& pos, Color strong_side);
+
+}  // namespace Clockwork::Endgame
@@ -0,0 +1,49 @@
+#include "eval_cache.hpp"
+#include "numa.hpp"
+#include <thread>
+#include <vector>
+
+namespace Clockwork {
+
+EvalCache::EvalCache(size_t mb) :
+    m_entries{nullptr},
+    m_size{0} {
+    resize(mb, 1);
+}
+
+void EvalCache::resize(size_t mb, usize thread_count) {
+    size_t bytes = mb * 1024 * 1024;
+
+    m_size    = bytes / sizeof(std::atomic<u64>);
+    m_entries = nullptr;
+    if (m_size > 0) {
+        m_entries = make_unique_for_overwrite_huge_page<std::atomic<u64>[]>(m_size);
+    }
+    interleave();
+    clear(thread_count);
+}
+
+void EvalCache::interleave() {
+    if (Numa::enabled) {
+        Numa::interleave(m_entries.get(), m_size * sizeof(std::atomic<u64>));
+    }
+}
+
+void EvalCache::clear(usize thread_count) {
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (usize t = 0; t < thread_count; ++t) {
+        threads.emplace_back([this, t, thread_count]() {
+            size_t start = (m_size * t) / thread_count;
+            size_t end   = (m_size * (t + 1)) / thread_count;
+            for (size_t i = start; i < end; ++i) {
+                m_entries[i].store(0, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace Clockwork
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "util/mem.hpp"
+#include "util/types.hpp"
+#include <atomic>
+#include <optional>
+
+namespace Clockwork {
+
+// Shared, lock-free cache of raw static evaluations.
+// Each entry packs the low 48 bits of the hash key and the 16-bit eval into one u64,
+// so a torn read can never pair a key with another position's eval.
+class EvalCache {
+public:
+    static constexpr size_t DEFAULT_SIZE_MB = 4;
+
+    EvalCache(size_t mb = DEFAULT_SIZE_MB);
+
+    [[nodiscard]] std::optional<Value> probe(HashKey key) const {
+        if (m_size == 0) {
+            return std::nullopt;
+        }
+        u64 data = entry(key).load(std::memory_order_relaxed);
+        if ((data >> 16) != (key & KEY_MASK)) {
+            return std::nullopt;
+        }
+        return static_cast<Value>(static_cast<i16>(data & 0xFFFF));
+    }
+
+    void store(HashKey key, Value eval) {
+        if (m_size == 0) {
+            return;
+        }
+        u64 data = ((key & KEY_MASK) << 16) | static_cast<u16>(static_cast<i16>(eval));
+        entry(key).store(data, std::memory_order_relaxed);
+    }
+
+    void resize(size_t mb, usize thread_count);
+    void clear(usize thread_count);
+    void interleave();
+
+    [[nodiscard]] size_t size_bytes() const {
+        return m_size * sizeof(std::atomic<u64>);
+    }
+
+private:
+    static constexpr u64 KEY_MASK = (u64{1} << 48) - 1;
+
+    [[nodiscard]] std::atomic<u64>& entry(HashKey key) const {
+        return m_entries[static_cast<size_t>((static_cast<u128>(key) * m_size) >> 64)];
+    }
+
+    unique_ptr_huge_page<std::atomic<u64>[]> m_entries;
+    size_t                                   m_size;
+};
+
+}  // namespace Clockwork
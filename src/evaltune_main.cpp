@@ -3,6 +3,9 @@
 #include "evaluation.hpp"
 #include "position.hpp"
 
+#include "tuning/checkpoint.hpp"
+#include "tuning/dataset.hpp"
+#include "tuning/features.hpp"
 #include "tuning/graph.hpp"
 #include "tuning/loss.hpp"
 #include "tuning/optim.hpp"
@@ -14,13 +17,17 @@
 
 #include <algorithm>
 #include <barrier>
+#include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <numeric>
+#include <optional>
 #include <random>
 #include <sstream>
+#include <string_view>
 #include <thread>
 #include <tuple>
 
@@ -29,14 +36,34 @@ using namespace Clockwork::Autograd;
 
 void print_params();
 
-int main() {
+int main(int argc, char* argv[]) {
+
+    // Written after every epoch; resume with --resume <checkpoint>
+    std::string                checkpoint_path = "evaltune.ckpt";
+    std::optional<std::string> resume_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--resume" && i + 1 < argc) {
+            resume_path = argv[++i];
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--checkpoint <file>] [--resume <file>]\n";
+            return 1;
+        }
+    }
 
     // Todo: make these CLI-specifiable
     const size_t batch_size       = 16 * 16384;
     const size_t micro_batch_size = 160;
 
-    std::vector<Position> positions;
-    std::vector<f64>      results;
+    // Record only the nonlinear part of the eval per position, with the linear terms precomputed
+    // as sparse coefficients. Disable to put the whole eval on the tape.
+    const bool use_sparse_features = true;
+
+    // Training positions stay packed, with their results, and are unpacked where they are used
+    std::vector<PackedPosition> records;
 
     const std::vector<std::string> fenFiles = {
       "data/v5_25knpm.txt",  "data/v4_8knpm.txt",    "data/v4_16knpm.txt",
@@ -47,135 +74,112 @@ int main() {
 
     std::cout << "Running on " << thread_count << " threads\n";
 
-    // Pre-pass: Count total lines to reserve memory
-    size_t total_positions_estimate = 0;
-    auto   count_lines              = [](const std::string& filename) -> size_t {
-        std::ifstream f(filename, std::ios::binary);
-        if (!f) {
-            return 0;
-        }
-        constexpr size_t  buffer_size = 128 * 1024;
-        std::vector<char> buffer(buffer_size);
-        size_t            lines = 0;
-        while (f.read(buffer.data(), buffer_size) || f.gcount() > 0) {
-            lines +=
-              static_cast<size_t>(std::count(buffer.data(), buffer.data() + f.gcount(), '\n'));
-            if (!f) {
-                break;
+    // Text datasets are converted once into packed datasets next to them, which load unparsed
+    std::vector<std::unique_ptr<Dataset>> datasets;
+    try {
+        for (const auto& filename : fenFiles) {
+            std::string packed_filename =
+              std::filesystem::path{filename}.replace_extension(".bin").string();
+            if (!is_dataset_current({filename}, packed_filename)) {
+                std::cout << "Converting " << filename << " to " << packed_filename << std::endl;
+                if (!convert_text_dataset({filename}, packed_filename)) {
+                    return 1;
+                }
             }
+            datasets.push_back(std::make_unique<Dataset>(packed_filename));
         }
-        return lines;
-    };
-
-    struct RawEntry {
-        std::string line;
-        std::string filename;
-    };
-
-    std::vector<RawEntry> raw_lines;
-
-    std::cout << "Counting positions..." << std::endl;
-    for (const auto& filename : fenFiles) {
-        total_positions_estimate += count_lines(filename);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
     }
-    std::cout << "Estimated positions: " << total_positions_estimate << "\n";
-
-    raw_lines.reserve(total_positions_estimate);
 
-    for (const auto& filename : fenFiles) {
-        std::ifstream fenFile(filename);
-        if (!fenFile) {
-            std::cerr << "Error opening " << filename << "\n";
-            return 1;
-        }
-        std::string line;
-        while (std::getline(fenFile, line)) {
-            raw_lines.push_back({std::move(line), filename});
-        }
+    size_t N = 0;
+    for (const auto& dataset : datasets) {
+        N += dataset->size();
     }
 
-    std::cout << "Read " << raw_lines.size() << " raw lines. Parsing...\n";
-
-    const size_t N = raw_lines.size();
+    std::cout << "Validating " << N << " positions...\n";
 
-    positions.resize(N);
-    results.resize(N, -1.0);
+    records.resize(N);
+    std::vector<u8> valid(N, 0);
 
-    advise_huge_pages(positions.data(), positions.capacity() * sizeof(Position));
-    advise_huge_pages(results.data(), results.capacity() * sizeof(f64));
+    advise_huge_pages(records.data(), records.capacity() * sizeof(PackedPosition));
 
     {
-        std::vector<std::thread> parse_threads;
-        parse_threads.reserve(thread_count);
+        std::vector<std::thread> decode_threads;
+        decode_threads.reserve(thread_count);
 
         for (u32 t = 0; t < thread_count; ++t) {
-            parse_threads.emplace_back([&, t]() {
-                for (size_t i = t; i < N; i += thread_count) {
-                    const auto& [line, filename] = raw_lines[i];
-
-                    size_t sep = line.find(';');
-                    if (sep == std::string::npos) {
-                        std::cerr << "Bad line in " << filename << ": " << line << "\n";
-                        continue;
-                    }
-
-                    auto parsed = Position::parse(line.substr(0, sep));
-                    if (!parsed) {
-                        std::cerr << "Failed to parse FEN in " << filename << ": "
-                                  << line.substr(0, sep) << "\n";
-                        continue;
-                    }
-
-                    std::string result = line.substr(sep + 1);
-                    result.erase(std::remove_if(result.begin(), result.end(), ::isspace),
-                                 result.end());
-
-                    f64 r;
-                    if (result == "w") {
-                        r = 1.0;
-                    } else if (result == "d") {
-                        r = 0.5;
-                    } else if (result == "b") {
-                        r = 0.0;
-                    } else {
-                        std::cerr << "Invalid result in " << filename << ": " << line << "\n";
-                        continue;
+            decode_threads.emplace_back([&, t]() {
+                size_t offset = 0;
+                for (size_t d = 0; d < datasets.size(); ++d) {
+                    const Dataset& dataset = *datasets[d];
+                    for (size_t i = t; i < dataset.size(); i += thread_count) {
+                        if (!dataset.position(i)) {
+                            std::cerr << "Invalid record " << i << " in " << fenFiles[d] << "\n";
+                            continue;
+                        }
+                        records[offset + i] = dataset.record(i);
+                        valid[offset + i]   = 1;
                     }
-
-                    positions[i] = *parsed;
-                    results[i]   = r;
+                    offset += dataset.size();
                 }
             });
         }
-        for (auto& th : parse_threads) {
+        for (auto& th : decode_threads) {
             th.join();
         }
     }
+    datasets.clear();
 
     {
         size_t write = 0;
         for (size_t read = 0; read < N; ++read) {
-            if (results[read] >= 0.0) {
-                if (write != read) {
-                    positions[write] = std::move(positions[read]);
-                    results[write]   = results[read];
-                }
-                ++write;
+            if (valid[read]) {
+                records[write++] = records[read];
             }
         }
-        positions.resize(write);
-        results.resize(write);
+        records.resize(write);
+        records.shrink_to_fit();
     }
+    valid = {};
 
-    std::cout << "Loaded " << positions.size() << " FENs.\n";
+    std::cout << "Loaded " << records.size() << " FENs ("
+              << records.size() * sizeof(PackedPosition) / 1024 << " KiB, "
+              << sizeof(PackedPosition) << " bytes per position).\n";
 
-    if (positions.empty()) {
+    if (records.empty()) {
         return 1;
     }
 
     // Setup tuning
     const ParameterCountInfo parameter_count = Globals::get().get_parameter_counts();
 
+    std::optional<FeatureSet> features;
+    if (use_sparse_features) {
+        std::cout << "Extracting features...\n";
+        try {
+            features.emplace(records, thread_count);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
+        // The extraction is exact only if the terms are linear, so compare against the full eval
+        // at unrelated parameter values
+        f64 error = features->max_error(
+          records, Parameters::rand_init(parameter_count, -1.0, 1.0), 4096);
+        if (error > 1e-6) {
+            std::cerr << "Sparse features disagree with the eval by " << error << "\n";
+            return 1;
+        }
+
+        // This stays resident next to the packed records for the whole run
+        std::cout << "Extracted " << features->coefficient_count() << " coefficients ("
+                  << features->memory_bytes() / 1024 << " KiB, "
+                  << features->memory_bytes() / features->size() << " bytes per position)\n";
+    }
+
     // This line loads the defaults from your S() macros
     Parameters current_parameter_values = Graph::get().get_all_parameter_values();
 
@@ -194,56 +198,98 @@ int main() {
     const f64 K = 1.0 / 400;
 
     std::mt19937        rng(std::random_device{}());
-    std::vector<size_t> indices(positions.size());
-
-    // Initialize indices 0..N-1
-    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<size_t> indices(records.size());
+
+    int start_epoch = 0;
+    if (resume_path) {
+        try {
+            start_epoch = static_cast<int>(load_checkpoint(*resume_path, records.size(),
+                                                           current_parameter_values, optim, rng));
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Resuming from " << *resume_path << " at epoch " << start_epoch + 1 << "\n";
+    }
 
     advise_huge_pages(indices.data(), indices.size() * sizeof(size_t));
 
-    const size_t total_batches = (positions.size() + batch_size - 1) / batch_size;
+    const size_t total_batches = (records.size() + batch_size - 1) / batch_size;
 
-    // Per-thread gradient buffers for lock-free accumulation
-    std::vector<Parameters> thread_grads(thread_count, Parameters::zeros(parameter_count));
+    // Per-thread gradient buffers for lock-free accumulation, each on its own cache lines
+    struct alignas(64) ThreadGradients {
+        Parameters grads;
+    };
+    std::vector<ThreadGradients> thread_grads(thread_count,
+                                              ThreadGradients{Parameters::zeros(parameter_count)});
 
-    for (auto& tg : thread_grads) {
+    for (auto& [tg] : thread_grads) {
         advise_huge_pages(tg.parameters.data(), tg.parameters.size() * sizeof(f64));
         advise_huge_pages(tg.pair_parameters.data(), tg.pair_parameters.size() * sizeof(f64x2));
     }
 
+    // The reduction and optimizer step are split into shards of the parameters, claimed by the
+    // workers as they finish their sub-batch. Each shard is tree-reduced into thread_grads[0] and
+    // stepped right away, so stepping one shard overlaps with reducing the next.
+    const u32        reduce_shards = std::max<u32>(1, thread_count * 4);
+    std::atomic<u32> next_shard{0};
+
     // Running batch loss accumulator
     std::atomic<f64> running_loss_accum{0.0};
 
-    std::barrier epoch_barrier{thread_count + 1};
+    // Tape taken by the first micro-batch of thread 0, for sizing micro-batches
+    TapeUsage first_tape_usage;
+    size_t    first_tape_positions = 0;
 
-    std::barrier batch_barrier{thread_count + 1, [&]() noexcept {
-                                   // Reduce all thread gradients into thread_grads[0]
-                                   for (u32 i = 1; i < thread_count; ++i) {
-                                       thread_grads[0].accumulate(thread_grads[i]);
-                                   }
+    std::barrier epoch_barrier{thread_count + 1};
 
-                                   // Apply optimizer
-                                   optim.step(current_parameter_values, thread_grads[0]);
+    std::barrier batch_barrier{thread_count, [&]() noexcept {
+                                   optim.begin_step();
+                                   next_shard.store(0, std::memory_order_relaxed);
                                }};
 
+    std::barrier reduce_barrier{thread_count + 1};
+
+    auto reduce_and_step = [&]() {
+        while (true) {
+            const u32 shard = next_shard.fetch_add(1, std::memory_order_relaxed);
+            if (shard >= reduce_shards) {
+                break;
+            }
+
+            const ParameterRange range = ParameterRange::shard(parameter_count, shard, reduce_shards);
+
+            // Pairwise tree over the threads, so no buffer is read more than log2(T) times
+            for (u32 stride = 1; stride < thread_count; stride *= 2) {
+                for (u32 i = 0; i + stride < thread_count; i += 2 * stride) {
+                    thread_grads[i].grads.accumulate(thread_grads[i + stride].grads, range);
+                }
+            }
+
+            optim.step(current_parameter_values, thread_grads[0].grads, range);
+        }
+    };
+
     // Spawn worker threads
     for (u32 t = 0; t < thread_count; ++t) {
         std::thread([&, t]() {
             // Pre-allocated buffers (reused across micro-batches)
-            std::vector<ValueHandle> outputs;
-            std::vector<f64>         targets;
+            std::vector<ValueHandle>   outputs;
+            std::vector<f64>           targets;
+            std::vector<FeatureInputs> inputs(micro_batch_size);
+            std::vector<Position>      positions(features ? 0 : micro_batch_size);
 
             outputs.reserve(micro_batch_size);
             targets.reserve(micro_batch_size);
 
-            for (int epoch = 0; epoch < epochs; ++epoch) {
+            for (int epoch = start_epoch; epoch < epochs; ++epoch) {
 
                 epoch_barrier.arrive_and_wait();
 
-                for (size_t batch_start = 0; batch_start < positions.size();
+                for (size_t batch_start = 0; batch_start < records.size();
                      batch_start += batch_size) {
 
-                    size_t batch_end       = std::min(batch_start + batch_size, positions.size());
+                    size_t batch_end       = std::min(batch_start + batch_size, records.size());
                     size_t this_batch_size = batch_end - batch_start;
 
                     size_t sub_size  = (this_batch_size + thread_count - 1) / thread_count;
@@ -251,7 +297,7 @@ int main() {
                     size_t sub_end   = std::min(sub_start + sub_size, batch_end);
 
                     // Clear thread-local gradients for this batch
-                    auto& my_grads = thread_grads[t];
+                    auto& my_grads = thread_grads[t].grads;
 
                     std::fill(my_grads.parameters.begin(), my_grads.parameters.end(), 0.0);
 
@@ -273,12 +319,25 @@ int main() {
                         outputs.clear();
                         targets.clear();
 
+                        // The full eval needs real positions, which only exist for the current
+                        // micro-batch. Unpacking runs on the workers, alongside the backward
+                        // passes of the other threads.
+                        if (!features) {
+                            for (size_t j = mb_start; j < mb_end; ++j) {
+                                positions[j - mb_start] = *Position::unpack(records[indices[j]]);
+                            }
+                        }
+
                         // Forward pass for this micro-batch
                         for (size_t j = mb_start; j < mb_end; ++j) {
 
-                            size_t idx = indices[j];
-                            outputs.push_back((evaluate_white_pov(positions[idx]) * K).sigmoid());
-                            targets.push_back(results[idx]);
+                            size_t      idx = indices[j];
+                            ValueHandle eval =
+                              features ? features->forward(idx, current_parameter_values,
+                                                           inputs[j - mb_start])
+                                       : evaluate_white_pov(positions[j - mb_start]);
+                            outputs.push_back((eval * K).sigmoid());
+                            targets.push_back(training_result(records[idx]));
                         }
 
                         // Backward pass
@@ -291,11 +350,22 @@ int main() {
 
                         Graph::get().backward();
 
+                        if (features) {
+                            for (size_t j = mb_start; j < mb_end; ++j) {
+                                features->backward(indices[j], inputs[j - mb_start], my_grads);
+                            }
+                        }
+
                         // Accumulate to thread-local buffer (no lock needed)
-                        my_grads.accumulate(Graph::get().get_all_parameter_gradients());
+                        Graph::get().accumulate_parameter_gradients(my_grads);
 
                         Graph::get().cleanup();
                         Graph::get().zero_grad();
+
+                        if (t == 0 && first_tape_positions == 0) {
+                            first_tape_usage     = Graph::get().last_usage();
+                            first_tape_positions = mb_end - mb_start;
+                        }
                     }
 
                     // Publish loss once per batch (very low overhead)
@@ -303,34 +373,40 @@ int main() {
                                                  std::memory_order_relaxed);
 
                     batch_barrier.arrive_and_wait();
+                    reduce_and_step();
+                    reduce_barrier.arrive_and_wait();
                 }
             }
         }).detach();
     }
 
-    // Freeze all parameters before tuning, except for material parameters.
     ParameterCountInfo counts = Globals::get().get_parameter_counts();
 
-    // Freeze all value
-    Globals::get().freeze_value_range(0, counts.parameter_count);
-
-    // Freeze all pair, except first 5 (material parameters)
-    Globals::get().freeze_pair_range(5, counts.pair_parameter_count);
-
-    // Epoch loop
-    for (int epoch = 0; epoch < epochs; ++epoch) {
+    // Sets which parameters train at `epoch`. Applied as a whole rather than as changes from the
+    // previous epoch, so that a resumed run starts with the right ones.
+    auto apply_freezes = [&](int epoch) {
+        // Freeze all parameters before tuning, except for material parameters.
+        Globals::get().freeze_value_range(0, counts.parameter_count);
+        Globals::get().freeze_pair_range(5, counts.pair_parameter_count);
 
-        if (epoch == 24) {
+        if (epoch >= 24) {
             // Unfreeze all parameters after 24 epochs. Dont unfreeze king safety just yet
             Globals::get().unfreeze_value_range(0, counts.parameter_count);
             Globals::get().unfreeze_pair_range(
               0, counts.pair_parameter_count - (28 + 7 + 28 + 5 + 5 + 1 + 1 + 1 + 1 + 1 + 2));
-            optim.set_lr(.1);
         }
-        if (epoch == 96) {
+        if (epoch >= 96) {
             // Unfreeze king safety parameters after 96 epochs
             Globals::get().unfreeze_pair_range(0, counts.pair_parameter_count);
         }
+    };
+
+    // Epoch loop
+    for (int epoch = start_epoch; epoch < epochs; ++epoch) {
+
+        if (epoch == start_epoch || epoch == 24 || epoch == 96) {
+            apply_freezes(epoch);
+        }
 
 
         if (epoch < 24) {
@@ -345,13 +421,15 @@ int main() {
 
         const auto start = time::Clock::now();
 
+        // Shuffled from the identity every epoch, so the order only depends on the RNG state
+        std::iota(indices.begin(), indices.end(), 0);
         std::shuffle(indices.begin(), indices.end(), rng);
 
         epoch_barrier.arrive_and_wait();
 
-        for (size_t bi = 0, bstart = 0; bstart < positions.size(); bstart += batch_size, ++bi) {
+        for (size_t bi = 0, bstart = 0; bstart < records.size(); bstart += batch_size, ++bi) {
 
-            batch_barrier.arrive_and_wait();
+            reduce_barrier.arrive_and_wait();
 
             const f64 running_loss = running_loss_accum.exchange(0.0, std::memory_order_relaxed);
 
@@ -374,6 +452,18 @@ int main() {
 
         std::cout << "// Epoch duration: " << time::cast<time::FloatSeconds>(end - start).count()
                   << "s\n";
+
+        if (epoch == 0 && first_tape_positions > 0) {
+            std::cout << "// Tape: " << first_tape_usage.bytes() / first_tape_positions
+                      << " bytes per position, " << first_tape_usage.bytes() / 1024
+                      << " KiB per micro-batch of " << first_tape_positions << "\n";
+        }
+
+        // A failed write keeps the previous checkpoint, which is better than stopping the run
+        if (!save_checkpoint(checkpoint_path, static_cast<u64>(epoch + 1), records.size(),
+                             current_parameter_values, optim, rng)) {
+            std::cerr << "Failed to write checkpoint for epoch " << epoch + 1 << "\n";
+        }
     }
 
     return 0;
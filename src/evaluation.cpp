@@ -2,7 +2,10 @@
 #include "bitboard.hpp"
 #include "common.hpp"
 #include "eval_constants.hpp"
+#include "endgame.hpp"
 #include "eval_types.hpp"
+#include "material_table.hpp"
+#include "pawn_table.hpp"
 #include "position.hpp"
 #include "psqt_state.hpp"
 #include "square.hpp"
@@ -14,9 +17,7 @@ namespace Clockwork {
 
 struct EvalData {
 
-    Bitboard any_attacks_by[2];
-    Bitboard any2_attacks_by[2];
-    Bitboard attacks_by_pt[2][7];
+    const AttackSummary* attacks = nullptr;
 
     Bitboard mobility_area[2];
 
@@ -24,32 +25,21 @@ struct EvalData {
     i32 wcount = 0;
     i32 bcount = 0;
 
-    void init(const Position& pos) {
-        any_attacks_by[0]  = pos.attack_table(Color::White).get_attacked_bitboard();
-        any_attacks_by[1]  = pos.attack_table(Color::Black).get_attacked_bitboard();
-        any2_attacks_by[0] = pos.attacked_by_two_or_more(Color::White);
-        any2_attacks_by[1] = pos.attacked_by_two_or_more(Color::Black);
+    void init(const Position& pos, const AttackSummary& attack_summary) {
+        attacks = &attack_summary;
+
+        const HashKey material_key = pos.get_material_key();
 
         for (PieceType pt : {PieceType::Pawn, PieceType::Knight, PieceType::Bishop, PieceType::Rook,
                              PieceType::Queen}) {
             m_piece_count[static_cast<usize>(Color::White)][static_cast<usize>(pt)] =
-              pos.i32piece_count(Color::White, pt);
+              material_key_count(material_key, Color::White, pt);
             m_piece_count[static_cast<usize>(Color::Black)][static_cast<usize>(pt)] =
-              pos.i32piece_count(Color::Black, pt);
-
-            attacks_by_pt[static_cast<usize>(Color::White)][static_cast<usize>(pt)] =
-              pos.attacked_by(Color::White, pt);
-            attacks_by_pt[static_cast<usize>(Color::Black)][static_cast<usize>(pt)] =
-              pos.attacked_by(Color::Black, pt);
+              material_key_count(material_key, Color::Black, pt);
 
             wcount += m_piece_count[static_cast<usize>(Color::White)][static_cast<usize>(pt)];
             bcount += m_piece_count[static_cast<usize>(Color::Black)][static_cast<usize>(pt)];
         }
-
-        attacks_by_pt[static_cast<usize>(Color::White)][static_cast<usize>(PieceType::King)] =
-          pos.attacked_by(Color::White, PieceType::King);
-        attacks_by_pt[static_cast<usize>(Color::Black)][static_cast<usize>(PieceType::King)] =
-          pos.attacked_by(Color::Black, PieceType::King);
     }
 
     inline i32 piece_count(const Color color, const PieceType pt) const {
@@ -61,15 +51,15 @@ struct EvalData {
     }
 
     inline Bitboard attacked_by(const Color color, const PieceType pt) const {
-        return attacks_by_pt[static_cast<usize>(color)][static_cast<usize>(pt)];
+        return attacks->by_pt[static_cast<usize>(color)][static_cast<usize>(pt)];
     }
 
     inline Bitboard attacked_by(const Color color) const {
-        return any_attacks_by[static_cast<usize>(color)];
+        return attacks->any[static_cast<usize>(color)];
     }
 
     inline Bitboard attacked_by_2(const Color color) const {
-        return any2_attacks_by[static_cast<usize>(color)];
+        return attacks->two_or_more[static_cast<usize>(color)];
     }
 };
 
@@ -212,14 +202,18 @@ std::array<std::array<Bitboard, 64>, 2> passed_pawn_spans = []() {
 }();
 
 template<Color color>
-PScore king_shelter(const Position& pos, const EvalData& eval_data) {
+PScore king_shelter(const Position& pos, PawnEntry& pawn_entry) {
     constexpr Color opp = ~color;
 
     Square king_square = pos.king_sq(color);
 
+    if (pawn_entry.shelter_king_sq[static_cast<usize>(color)] == king_square) {
+        return pawn_entry.shelter[static_cast<usize>(color)];
+    }
+
     Bitboard b = ~Bitboard::forward_ranks(opp, king_square);  // Squares ahead or on king's rank
     Bitboard our_pawns =
-      pos.bitboard_for(color, PieceType::Pawn) & b & ~eval_data.attacked_by(opp, PieceType::Pawn);
+      pos.bitboard_for(color, PieceType::Pawn) & b & ~pawn_entry.attacks[static_cast<usize>(opp)];
     Bitboard their_pawns = pos.bitboard_for(opp, PieceType::Pawn) & b;
 
     PScore score = PSCORE_ZERO;
@@ -248,78 +242,109 @@ PScore king_shelter(const Position& pos, const EvalData& eval_data) {
         }
     }
 
+    pawn_entry.shelter_king_sq[static_cast<usize>(color)] = king_square;
+    pawn_entry.shelter[static_cast<usize>(color)]         = score;
+
     return score;
 }
 
+// Fills in the pawn-only part of the pawn entry for one side.
 template<Color color>
-std::tuple<PScore, i32> evaluate_pawns(const Position& pos, const EvalData& data) {
+PScore evaluate_pawn_structure(const Position& pos, PawnEntry& pawn_entry) {
     constexpr i32   RANK_2 = 1;
     constexpr i32   RANK_3 = 2;
     constexpr Color them   = color == Color::White ? Color::Black : Color::White;
 
-    Square our_king   = pos.king_sq(color);
-    Square their_king = pos.king_sq(them);
-    PScore eval       = PSCORE_ZERO;
-
-    i32 passers = 0;
+    PScore eval = PSCORE_ZERO;
 
     Bitboard pawns     = pos.board().bitboard_for(color, PieceType::Pawn);
-    Bitboard opp_pawns = pos.board().bitboard_for(~color, PieceType::Pawn);
+    Bitboard opp_pawns = pos.board().bitboard_for(them, PieceType::Pawn);
 
-    Bitboard pawn_files = Bitboard::fill_verticals(pawns);
-    Bitboard doubled    = pawns & pawns.shift(Direction::North);
+    Bitboard pawn_files   = Bitboard::fill_verticals(pawns);
+    Bitboard pawn_attacks = static_pawn_attacks<color>(pawns);
+    Bitboard doubled      = pawns & pawns.shift(Direction::North);
     Bitboard isolated =
       pawns & ~(pawn_files.shift(Direction::East) | pawn_files.shift(Direction::West));
     eval += DOUBLED_PAWN_VAL * doubled.ipopcount();
     eval += ISOLATED_PAWN_VAL * isolated.ipopcount();
 
+    Bitboard passed{};
     for (Square sq : pawns) {
-        Square   push     = sq.push<color>();
         Bitboard stoppers = opp_pawns & passed_pawn_spans[static_cast<usize>(color)][sq.raw];
         if (stoppers.empty()) {
-            ++passers;
-
+            passed |= Bitboard::from_square(sq);
             eval += PASSED_PAWN[static_cast<usize>(sq.relative_sq(color).rank() - RANK_2)];
-
-            if ((passed_pawn_spans[static_cast<usize>(color)][sq.raw] & data.attacked_by(them))
-                  .empty()) {
-                eval +=
-                  PASSED_CLEAR_STOPPERS[static_cast<usize>(sq.relative_sq(color).rank() - RANK_2)];
-            } else if ((Bitboard::forward_ranks(color, sq) & Bitboard::file_mask(sq.file())
-                        & data.attacked_by(them))
-                         .empty()) {
-                eval +=
-                  PASSED_CLEAR_FORWARD[static_cast<usize>(sq.relative_sq(color).rank() - RANK_2)];
-            } else if (pos.attack_table(color).read(push).popcount()
-                       > pos.attack_table(them).read(push).popcount()) {
-                eval +=
-                  DEFENDED_PASSED_PUSH[static_cast<usize>(sq.relative_sq(color).rank() - RANK_2)];
-            }
-
-            if (pos.piece_at(push) != PieceType::None) {
-                eval +=
-                  BLOCKED_PASSED_PAWN[static_cast<usize>(sq.relative_sq(color).rank() - RANK_2)];
-            }
-
-            i32 our_king_dist   = chebyshev_distance(our_king, sq);
-            i32 their_king_dist = chebyshev_distance(their_king, sq);
-
-            eval += FRIENDLY_KING_PASSED_PAWN_DISTANCE[static_cast<usize>(our_king_dist)];
-            eval += ENEMY_KING_PASSED_PAWN_DISTANCE[static_cast<usize>(their_king_dist)];
         }
     }
 
-
     Bitboard phalanx = pawns & pawns.shift(Direction::East);
     for (Square sq : phalanx) {
         eval += PAWN_PHALANX[static_cast<usize>(sq.relative_sq(color).rank() - RANK_2)];
     }
 
-    Bitboard defended = pawns & data.attacked_by(color, PieceType::Pawn);
+    Bitboard defended = pawns & pawn_attacks;
     for (Square sq : defended) {
         eval += DEFENDED_PAWN[static_cast<usize>(sq.relative_sq(color).rank() - RANK_3)];
     }
 
+    pawn_entry.passed[static_cast<usize>(color)]       = passed;
+    pawn_entry.attacks[static_cast<usize>(color)]      = pawn_attacks;
+    // Squares our pawns can ever attack. Note, this does NOT consider pins!
+    pawn_entry.span_attacks[static_cast<usize>(color)] =
+      static_pawn_attacks<color>(pawn_spans<color>(pawns));
+    pawn_entry.files[static_cast<usize>(color)] = pawn_files;
+
+    return eval;
+}
+
+void fill_pawn_entry(const Position& pos, PawnEntry& pawn_entry) {
+    pawn_entry.score = evaluate_pawn_structure<Color::White>(pos, pawn_entry)
+                     - evaluate_pawn_structure<Color::Black>(pos, pawn_entry);
+    pawn_entry.valid = true;
+}
+
+// Passed pawn terms that depend on pieces, attacks and kings, on top of the cached pawn entry.
+template<Color color>
+std::tuple<PScore, i32> evaluate_pawns(const Position&  pos,
+                                       const EvalData&  data,
+                                       const PawnEntry& pawn_entry) {
+    constexpr i32   RANK_2 = 1;
+    constexpr Color them   = color == Color::White ? Color::Black : Color::White;
+
+    Square our_king   = pos.king_sq(color);
+    Square their_king = pos.king_sq(them);
+    PScore eval       = PSCORE_ZERO;
+
+    Bitboard passed  = pawn_entry.passed[static_cast<usize>(color)];
+    i32      passers = passed.ipopcount();
+
+    for (Square sq : passed) {
+        Square push = sq.push<color>();
+        usize  rank = static_cast<usize>(sq.relative_sq(color).rank() - RANK_2);
+
+        if ((passed_pawn_spans[static_cast<usize>(color)][sq.raw] & data.attacked_by(them))
+              .empty()) {
+            eval += PASSED_CLEAR_STOPPERS[rank];
+        } else if ((Bitboard::forward_ranks(color, sq) & Bitboard::file_mask(sq.file())
+                    & data.attacked_by(them))
+                     .empty()) {
+            eval += PASSED_CLEAR_FORWARD[rank];
+        } else if (pos.attack_table(color).read(push).popcount()
+                   > pos.attack_table(them).read(push).popcount()) {
+            eval += DEFENDED_PASSED_PUSH[rank];
+        }
+
+        if (pos.piece_at(push) != PieceType::None) {
+            eval += BLOCKED_PASSED_PAWN[rank];
+        }
+
+        i32 our_king_dist   = chebyshev_distance(our_king, sq);
+        i32 their_king_dist = chebyshev_distance(their_king, sq);
+
+        eval += FRIENDLY_KING_PASSED_PAWN_DISTANCE[static_cast<usize>(our_king_dist)];
+        eval += ENEMY_KING_PASSED_PAWN_DISTANCE[static_cast<usize>(their_king_dist)];
+    }
+
     return {eval, passers};
 }
 
@@ -406,7 +431,9 @@ PScore evaluate_pieces(const Position& pos, EvalData& data) {
 }
 
 template<Color color>
-PScore evaluate_outposts(const Position& pos, const EvalData& data) {
+PScore evaluate_outposts(const Position&  pos,
+                         const EvalData&  data,
+                         const PawnEntry& pawn_entry) {
     // First calculate all the viable outpost squares
     // A viable outpost square is one that is not attackable by enemy pawns and is:
     // - on ranks 4,5,6 for white (5,4,3 for black)
@@ -417,11 +444,8 @@ PScore evaluate_outposts(const Position& pos, const EvalData& data) {
       color == Color::White
         ? Bitboard::rank_mask(3) | Bitboard::rank_mask(4) | Bitboard::rank_mask(5)
         : Bitboard::rank_mask(2) | Bitboard::rank_mask(3) | Bitboard::rank_mask(4);
-    // Get enemy pawns to calculate the attacks and attack spans
-    Bitboard opp_pawns             = pos.bitboard_for(opp, PieceType::Pawn);
-    Bitboard opp_pawn_span         = pawn_spans<opp>(opp_pawns);
-    Bitboard opp_pawn_span_attacks = static_pawn_attacks<opp>(
-      opp_pawn_span);  // Note, this does NOT consider pins! Might need to test this more thoroughly.
+    // Enemy pawn attack spans come from the pawn entry
+    Bitboard opp_pawn_span_attacks = pawn_entry.span_attacks[static_cast<usize>(opp)];
     Bitboard pawn_defended_squares = data.attacked_by(color, PieceType::Pawn);
     Bitboard viable_outposts =
       viable_outposts_ranks & pawn_defended_squares & ~opp_pawn_span_attacks;
@@ -457,7 +481,7 @@ PScore evaluate_potential_checkers(const Position& pos) {
 }
 
 template<Color color>
-PScore evaluate_king_safety(const Position& pos, const EvalData& data) {
+PScore evaluate_king_safety(const Position& pos, const EvalData& data, PawnEntry& pawn_entry) {
     constexpr Color opp = ~color;
 
     // Iterate over the opponent's attack bbs
@@ -494,7 +518,7 @@ PScore evaluate_king_safety(const Position& pos, const EvalData& data) {
     eval += KS_FLANK_DOUBLE_ATTACK * (double_attacked_by_them & flank).ipopcount();
 
     // King shelter evaluation
-    eval += king_shelter<color>(pos, data);
+    eval += king_shelter<color>(pos, pawn_entry);
 
     eval += KS_NO_QUEEN * (pos.bitboard_for(opp, PieceType::Queen).empty());
 
@@ -591,11 +615,11 @@ PScore evaluate_threats(const Position& pos, const EvalData& data) {
 }
 
 template<Color color>
-PScore evaluate_space(const Position& pos, const EvalData& data) {
+PScore evaluate_space(const Position& pos, const PawnEntry& pawn_entry) {
     PScore          eval       = PSCORE_ZERO;
     constexpr Color them       = color == Color::White ? Color::Black : Color::White;
-    Bitboard        ourfiles   = Bitboard::fill_verticals(pos.bitboard_for(color, PieceType::Pawn));
-    Bitboard        theirfiles = Bitboard::fill_verticals(pos.bitboard_for(them, PieceType::Pawn));
+    Bitboard        ourfiles   = pawn_entry.files[static_cast<usize>(color)];
+    Bitboard        theirfiles = pawn_entry.files[static_cast<usize>(them)];
     Bitboard        openfiles  = ~(ourfiles | theirfiles);
     Bitboard        half_open_files = (~ourfiles) & theirfiles;
     Bitboard        ourminors =
@@ -620,8 +644,7 @@ PScore king_safety_activation(PScore& king_safety_score) {
     return activated;
 }
 
-PScore apply_winnable(const Position& pos, PScore& score, i32 phase) {
-
+Score winnable_base(const Position& pos, i32 phase, const PawnEntry& pawn_entry) {
     bool pawn_endgame = phase == 0;
 
     Bitboard white_pawns = pos.bitboard_for(Color::White, PieceType::Pawn);
@@ -629,17 +652,19 @@ PScore apply_winnable(const Position& pos, PScore& score, i32 phase) {
 
     i32 pawn_count = (white_pawns | black_pawns).ipopcount();
 
-    Bitboard white_files = Bitboard::fill_verticals(white_pawns);
-    Bitboard black_files = Bitboard::fill_verticals(black_pawns);
+    Bitboard white_files = pawn_entry.files[static_cast<usize>(Color::White)];
+    Bitboard black_files = pawn_entry.files[static_cast<usize>(Color::Black)];
 
     i32 sym_files  = (white_files & black_files).ipopcount() / 8;
     i32 asym_files = (white_files ^ black_files).ipopcount() / 8;
 
     Score symmetry = static_cast<Score>(WINNABLE_SYM * sym_files + WINNABLE_ASYM * asym_files);
 
-    Score winnable = static_cast<Score>(WINNABLE_PAWNS * pawn_count + symmetry
-                                        + WINNABLE_PAWN_ENDGAME * pawn_endgame + WINNABLE_BIAS);
+    return static_cast<Score>(WINNABLE_PAWNS * pawn_count + symmetry
+                              + WINNABLE_PAWN_ENDGAME * pawn_endgame + WINNABLE_BIAS);
+}
 
+PScore apply_winnable(PScore& score, Score winnable) {
     if (score.eg() < 0) {
         winnable = static_cast<Score>(-winnable);
     }
@@ -647,16 +672,13 @@ PScore apply_winnable(const Position& pos, PScore& score, i32 phase) {
     return score.complexity_add(winnable);
 }
 
-PScore apply_eg_scale(const Position& pos,
-                      PScore&         eval,
-                      i32             strong_phase,
-                      i32             weak_phase,
-                      i32             strong_passers,
-                      i32             weak_passers,
-                      EvalData&       eval_data) {
-    // Strong pawn scaling
-    const Color strong_side = eval.eg() > 0 ? Color::White : Color::Black;
-
+i32 eg_scale(const Position& pos,
+             Color           strong_side,
+             i32             strong_phase,
+             i32             weak_phase,
+             i32             strong_passers,
+             i32             weak_passers,
+             EvalData&       eval_data) {
     // Swap phases if we're in the weak side's perspective
     if (strong_side == Color::Black) {
         std::swap(strong_phase, weak_phase);
@@ -669,55 +691,86 @@ PScore apply_eg_scale(const Position& pos,
     // Pawnless position scaling: if our material advantage is very thin and we have no pawns, scale down the eval significantly, as trading can lead to KBK or KNK draws
     if (strong_pawn_count == 0) {
         if (strong_phase - weak_phase <= 1) {
-            return eval.scale_eg<128>(strong_phase < 2 ? 0 : weak_phase <= 1 ? 8 : 28);
+            return strong_phase < 2 ? 0 : weak_phase <= 1 ? 8 : 28;
         }
     } else if (pos.is_opposite_bishops()) {
         // Opposite bishops scaling: pure bishops endgame / other pieces present
         if (strong_phase == 1 && weak_phase == 1) {
-            return eval.scale_eg<128>(28 + 8 * strong_passers
-                                      + 8 * (strong_pawn_count >= weak_pawn_count + 2));
+            return 28 + 8 * strong_passers + 8 * (strong_pawn_count >= weak_pawn_count + 2);
         } else {
-            return eval.scale_eg<128>(44 + 3 * pos.piece_count(strong_side));
+            return 44 + 3 * static_cast<i32>(pos.piece_count(strong_side));
         }
     }
 
-    const isize pcmul = 8 - strong_pawn_count;
+    const i32 pcmul = 8 - strong_pawn_count;
 
-    return eval.scale_eg<128>(static_cast<i32>(128 - pcmul * pcmul));  // 64 - 128
+    return 128 - pcmul * pcmul;  // 64 - 128
 }
 
-Score evaluate_white_pov(const Position& pos, const PsqtState& psqt_state) {
-    const Color us = pos.active_color();
+PScore apply_eg_scale(const Position& pos,
+                      PScore&         eval,
+                      i32             white_phase,
+                      i32             black_phase,
+                      i32             white_passers,
+                      i32             black_passers,
+                      EvalData&       eval_data) {
+    // Strong pawn scaling
+    const Color strong_side = eval.eg() > 0 ? Color::White : Color::Black;
 
-    EvalData eval_data;
-    eval_data.init(pos);
+    return eval.scale_eg<128>(eg_scale(pos, strong_side, white_phase, black_phase, white_passers,
+                                       black_passers, eval_data));
+}
 
-    const i32 white_phase = eval_data.piece_count(Color::White, PieceType::Knight)
-                          + eval_data.piece_count(Color::White, PieceType::Bishop)
-                          + eval_data.piece_count(Color::White, PieceType::Rook) * 2
-                          + eval_data.piece_count(Color::White, PieceType::Queen) * 4;
+void fill_material_entry(HashKey material_key, MaterialEntry& material_entry) {
+    auto side_phase = [material_key](Color color) {
+        return material_key_count(material_key, color, PieceType::Knight)
+             + material_key_count(material_key, color, PieceType::Bishop)
+             + material_key_count(material_key, color, PieceType::Rook) * 2
+             + material_key_count(material_key, color, PieceType::Queen) * 4;
+    };
+
+    material_entry.white_phase = side_phase(Color::White);
+    material_entry.black_phase = side_phase(Color::Black);
+    material_entry.phase =
+      std::min<i32>(material_entry.white_phase + material_entry.black_phase, 24);
+#ifndef EVAL_TUNING
+    material_entry.endgame = Endgame::find(material_key);
+#endif
+    material_entry.valid = true;
+}
 
-    const i32 black_phase = eval_data.piece_count(Color::Black, PieceType::Knight)
-                          + eval_data.piece_count(Color::Black, PieceType::Bishop)
-                          + eval_data.piece_count(Color::Black, PieceType::Rook) * 2
-                          + eval_data.piece_count(Color::Black, PieceType::Queen) * 4;
+// Everything that is linear in the parameters, plus the inputs of the king safety activation
+struct LinearTerms {
+    PScore eval;
+    PScore white_king_attack;
+    PScore black_king_attack;
+    i32    white_passers;
+    i32    black_passers;
+};
 
-    i32 phase = std::min<i32>(white_phase + black_phase, 24);
+static LinearTerms evaluate_linear_terms(const Position&  pos,
+                                         const PsqtState& psqt_state,
+                                         PawnEntry&       pawn_entry,
+                                         EvalData&        eval_data) {
+    const Color us = pos.active_color();
 
     PScore eval = psqt_state.score();  // Used for linear components
 
     // pawn eval
-    auto [white_pawn_eval, white_passers] = evaluate_pawns<Color::White>(pos, eval_data);
-    auto [black_pawn_eval, black_passers] = evaluate_pawns<Color::Black>(pos, eval_data);
+    eval += pawn_entry.score;
+    auto [white_pawn_eval, white_passers] =
+      evaluate_pawns<Color::White>(pos, eval_data, pawn_entry);
+    auto [black_pawn_eval, black_passers] =
+      evaluate_pawns<Color::Black>(pos, eval_data, pawn_entry);
     eval += white_pawn_eval - black_pawn_eval;
 
     // pieces & space
     eval +=
       evaluate_pieces<Color::White>(pos, eval_data) - evaluate_pieces<Color::Black>(pos, eval_data);
-    eval += evaluate_outposts<Color::White>(pos, eval_data)
-          - evaluate_outposts<Color::Black>(pos, eval_data);
+    eval += evaluate_outposts<Color::White>(pos, eval_data, pawn_entry)
+          - evaluate_outposts<Color::Black>(pos, eval_data, pawn_entry);
     eval +=
-      evaluate_space<Color::White>(pos, eval_data) - evaluate_space<Color::Black>(pos, eval_data);
+      evaluate_space<Color::White>(pos, pawn_entry) - evaluate_space<Color::Black>(pos, pawn_entry);
 
     // Threats
     eval += evaluate_threats<Color::White>(pos, eval_data)
@@ -729,30 +782,173 @@ Score evaluate_white_pov(const Position& pos, const PsqtState& psqt_state) {
     eval += evaluate_potential_checkers<Color::White>(pos)
           - evaluate_potential_checkers<Color::Black>(pos);
 
+    eval += (us == Color::White) ? TEMPO_VAL : -TEMPO_VAL;
+
     // Nonlinear king safety components
-    PScore white_king_attack_total = evaluate_king_safety<Color::Black>(pos, eval_data);
-    PScore black_king_attack_total = evaluate_king_safety<Color::White>(pos, eval_data);
+    PScore white_king_attack_total =
+      evaluate_king_safety<Color::Black>(pos, eval_data, pawn_entry);
+    PScore black_king_attack_total =
+      evaluate_king_safety<Color::White>(pos, eval_data, pawn_entry);
 
-    // Nonlinear adjustment
-    eval += king_safety_activation<Color::White>(white_king_attack_total)
-          - king_safety_activation<Color::Black>(black_king_attack_total);
+    return {eval, white_king_attack_total, black_king_attack_total, white_passers, black_passers};
+}
 
-    eval += (us == Color::White) ? TEMPO_VAL : -TEMPO_VAL;
+// The lazy window is ignored when tuning, which always needs the full eval
+static Score evaluate_white_pov(const Position&                    pos,
+                                const PsqtState&                   psqt_state,
+                                PawnEntry&                         pawn_entry,
+                                MaterialEntry&                     material_entry,
+                                AttackSummaryCache&                attack_cache,
+                                [[maybe_unused]] const LazyWindow* window = nullptr,
+                                [[maybe_unused]] bool*             lazy   = nullptr) {
+    if (!material_entry.valid) {
+        fill_material_entry(pos.get_material_key(), material_entry);
+    }
+
+#ifndef EVAL_TUNING
+    // Known endgames skip the regular eval entirely
+    if (material_entry.endgame.fn) {
+        Color strong_side = material_entry.endgame.strong_side;
+        Value score       = material_entry.endgame.fn(pos, strong_side);
+        return static_cast<Score>(strong_side == Color::White ? score : -score);
+    }
+#endif
+
+    if (!pawn_entry.valid) {
+        fill_pawn_entry(pos, pawn_entry);
+    }
+
+#ifndef EVAL_TUNING
+    // Lazy eval: skip the remaining terms when the cheap ones are already far outside the window
+    if (window) {
+        const Color us = pos.active_color();
+
+        PScore partial   = psqt_state.score() + pawn_entry.score
+                         + ((us == Color::White) ? TEMPO_VAL : -TEMPO_VAL);
+        Score  lazy_eval = static_cast<Score>(partial.phase<24>(material_entry.phase));
+        Value  stm_eval  = us == Color::White ? lazy_eval : -lazy_eval;
+        if (stm_eval + window->margin <= window->alpha
+            || stm_eval - window->margin >= window->beta) {
+            *lazy = true;
+            return lazy_eval;
+        }
+    }
+#endif
+
+    EvalData eval_data;
+    eval_data.init(pos, attack_cache.get(pos));
+
+    const i32 white_phase = material_entry.white_phase;
+    const i32 black_phase = material_entry.black_phase;
+    const i32 phase       = material_entry.phase;
+
+    LinearTerms terms = evaluate_linear_terms(pos, psqt_state, pawn_entry, eval_data);
+
+    // Nonlinear adjustment
+    PScore eval = terms.eval + king_safety_activation<Color::White>(terms.white_king_attack)
+                - king_safety_activation<Color::Black>(terms.black_king_attack);
 
     // Winnable
-    eval = apply_winnable(pos, eval, phase);
+    eval = apply_winnable(eval, winnable_base(pos, phase, pawn_entry));
 
     // Eg scaling
-    eval =
-      apply_eg_scale(pos, eval, white_phase, black_phase, white_passers, black_passers, eval_data);
+    eval = apply_eg_scale(pos, eval, white_phase, black_phase, terms.white_passers,
+                          terms.black_passers, eval_data);
 
     return static_cast<Score>(eval.phase<24>(static_cast<i32>(phase)));
 };
 
+#ifdef EVAL_TUNING
+EvalTerms evaluate_terms(const Position& pos) {
+    PawnEntry     pawn_entry;
+    MaterialEntry material_entry;
+    fill_material_entry(pos.get_material_key(), material_entry);
+    fill_pawn_entry(pos, pawn_entry);
+
+    const AttackSummary attack_summary{pos};
+
+    EvalData eval_data;
+    eval_data.init(pos, attack_summary);
+
+    const i32 white_phase = material_entry.white_phase;
+    const i32 black_phase = material_entry.black_phase;
+    const i32 phase       = material_entry.phase;
+
+    LinearTerms terms = evaluate_linear_terms(pos, PsqtState{pos}, pawn_entry, eval_data);
+
+    auto scale = [&](Color strong_side) {
+        return eg_scale(pos, strong_side, white_phase, black_phase, terms.white_passers,
+                        terms.black_passers, eval_data);
+    };
+
+    return {terms.eval,
+            terms.white_king_attack,
+            terms.black_king_attack,
+            winnable_base(pos, phase, pawn_entry),
+            phase,
+            {scale(Color::White), scale(Color::Black)}};
+}
+
+Score evaluate_head(const EvalTerms& terms) {
+    PScore white_king_attack = terms.white_king_attack;
+    PScore black_king_attack = terms.black_king_attack;
+
+    PScore eval = terms.linear + king_safety_activation<Color::White>(white_king_attack)
+                - king_safety_activation<Color::Black>(black_king_attack);
+
+    eval = apply_winnable(eval, terms.winnable);
+
+    const Color strong_side = eval.eg() > 0 ? Color::White : Color::Black;
+    eval = eval.scale_eg<128>(terms.eg_scale[static_cast<usize>(strong_side)]);
+
+    return static_cast<Score>(eval.phase<24>(terms.phase));
+}
+#endif
+
+Score evaluate_white_pov(const Position& pos, const PsqtState& psqt_state) {
+    PawnEntry          pawn_entry;
+    MaterialEntry      material_entry;
+    AttackSummaryCache attack_cache;
+    return evaluate_white_pov(pos, psqt_state, pawn_entry, material_entry, attack_cache);
+}
+
+Score evaluate_white_pov(const Position&  pos,
+                         const PsqtState& psqt_state,
+                         PawnTable&       pawn_table,
+                         MaterialTable&   material_table) {
+    AttackSummaryCache attack_cache;
+    return evaluate_white_pov(pos, psqt_state, pawn_table.probe(pos.get_pawn_key()),
+                              material_table.probe(pos.get_material_key()), attack_cache);
+}
+
 Score evaluate_stm_pov(const Position& pos, const PsqtState& psqt_state) {
     const Color us = pos.active_color();
     return static_cast<Score>((us == Color::White) ? evaluate_white_pov(pos, psqt_state)
                                                    : -evaluate_white_pov(pos, psqt_state));
 }
 
+Score evaluate_stm_pov(const Position&  pos,
+                       const PsqtState& psqt_state,
+                       PawnTable&       pawn_table,
+                       MaterialTable&   material_table) {
+    const Color us = pos.active_color();
+    Score       white_eval = evaluate_white_pov(pos, psqt_state, pawn_table, material_table);
+    return static_cast<Score>((us == Color::White) ? white_eval : -white_eval);
+}
+
+Score evaluate_stm_pov(const Position&     pos,
+                       const PsqtState&    psqt_state,
+                       PawnTable&          pawn_table,
+                       MaterialTable&      material_table,
+                       AttackSummaryCache& attack_cache,
+                       const LazyWindow&   window,
+                       bool&               lazy) {
+    const Color us         = pos.active_color();
+    Score       white_eval =
+      evaluate_white_pov(pos, psqt_state, pawn_table.probe(pos.get_pawn_key()),
+                         material_table.probe(pos.get_material_key()), attack_cache, &window,
+                         &lazy);
+    return static_cast<Score>((us == Color::White) ? white_eval : -white_eval);
+}
+
 }  // namespace Clockwork
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "eval_types.hpp"
+#include "material_table.hpp"
+#include "pawn_table.hpp"
 #include "position.hpp"
 #include "psqt_state.hpp"
 #include <array>
@@ -10,6 +12,35 @@ namespace Clockwork {
 Score evaluate_white_pov(const Position& pos, const PsqtState& psqt_state);
 Score evaluate_stm_pov(const Position& pos, const PsqtState& psqt_state);
 
+// Same as above, but pawn structure and material terms are looked up in (and saved to) the given
+// per-thread tables.
+Score evaluate_white_pov(const Position&  pos,
+                         const PsqtState& psqt_state,
+                         PawnTable&       pawn_table,
+                         MaterialTable&   material_table);
+Score evaluate_stm_pov(const Position&  pos,
+                       const PsqtState& psqt_state,
+                       PawnTable&       pawn_table,
+                       MaterialTable&   material_table);
+
+// Search window for lazy evaluation, from the side to move's point of view.
+struct LazyWindow {
+    Value alpha;
+    Value beta;
+    Value margin;
+};
+
+// Lazy variant: if the psqt, material and pawn structure terms alone are more than `margin`
+// outside of the window, that partial score is returned and `lazy` is set. Otherwise the attack
+// summary is taken from (and saved to) `attack_cache`, shared with the rest of the search node.
+Score evaluate_stm_pov(const Position&     pos,
+                       const PsqtState&    psqt_state,
+                       PawnTable&          pawn_table,
+                       MaterialTable&      material_table,
+                       AttackSummaryCache& attack_cache,
+                       const LazyWindow&   window,
+                       bool&               lazy);
+
 inline Score evaluate_white_pov(const Position& pos) {
     return evaluate_white_pov(pos, PsqtState{pos});
 }
@@ -18,6 +49,25 @@ inline Score evaluate_stm_pov(const Position& pos) {
     return evaluate_stm_pov(pos, PsqtState{pos});
 }
 
+#ifdef EVAL_TUNING
+// The eval split where it stops being linear in the parameters. The first four terms are linear;
+// phase and the endgame scale of either strong side do not depend on the parameters at all.
+struct EvalTerms {
+    PScore             linear;
+    PScore             white_king_attack;
+    PScore             black_king_attack;
+    Score              winnable;
+    i32                phase;
+    std::array<i32, 2> eg_scale;  // Indexed by the strong side
+};
+
+EvalTerms evaluate_terms(const Position& pos);
+
+// Applies king safety activation, winnable and endgame scaling to the terms, exactly as
+// evaluate_white_pov does.
+Score evaluate_head(const EvalTerms& terms);
+#endif
+
 static constexpr std::array<std::array<Bitboard, 8>, 2> king_flank = []() {
     std::array<std::array<Bitboard, 8>, 2> result{};
 
@@ -0,0 +1,157 @@
+#include "genfens.hpp"
+#include "movepick.hpp"
+#include "position.hpp"
+#include "repetition_info.hpp"
+#include "search.hpp"
+#include "util/random.hpp"
+#include "util/types.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace Clockwork {
+namespace Genfens {
+
+// How many verified positions a thread may have waiting before it pauses for the others
+constexpr usize MAX_PENDING = 64;
+
+// Line generation is as follows:
+// 1) Pick a random line from the book (or startposition if no book)
+// 2) Play random legal moves (see passing noisy or quiet moves)
+// Launch a 16k softnodes verification search to make sure the position doesn't lose immediately
+// 3) If the position is legal, keep it
+std::optional<Position> generate_opening(Search::Searcher&               searcher,
+                                         const std::vector<std::string>& book,
+                                         i32                             rand_moves) {
+    // Pick a random line from the book
+    const std::string& selected_line = book[Random::rand_64() % book.size()];
+
+    // Set up position
+    Position pos = *Position::parse(selected_line);
+
+    for (i32 moves = 0; moves < rand_moves; moves++) {
+        RandomMovePicker picker(pos);
+        Move             m = picker.next();
+        if (m == Move::none()) {
+            // No moves available, skip
+            return std::nullopt;
+        }
+        pos = pos.move(m);
+    }
+
+    // Mock search limits for datagen verification
+    Search::SearchSettings settings = {
+      .stm = pos.active_color(), .hard_nodes = 1048576, .soft_nodes = 16384, .silent = true};
+
+    RepetitionInfo rep_info;
+    rep_info.reset();
+    rep_info.push(pos.get_hash_key(), false);
+
+    searcher.set_position(pos, rep_info);
+    searcher.launch_search(settings);
+
+    // Wait for the search to finish and get the score
+    Value score = searcher.wait_for_score();
+
+    if (std::abs(score) > 450) {
+        // Position is mate or losing, skip
+        return std::nullopt;
+    }
+
+    return pos;
+}
+
+void seed_thread_stream(u64 seed, usize thread) {
+    // The other threads get their own PCG streams by varying the increment
+    Random::seed({seed, seed, seed | 1, (seed ^ 0xDEADBEEFDEADBEEFULL) + thread});
+}
+
+void genfens(const GenfensOptions& options) {
+    usize thread_count = std::max<usize>(1, options.threads);
+
+    std::vector<std::string> book = options.book;
+    if (book.empty()) {
+        book.push_back("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    }
+
+    std::mutex                        mutex;
+    std::condition_variable           cv;
+    std::vector<std::deque<Position>> pending(thread_count);
+    bool                              stop = false;
+
+    auto generate = [&](usize thread) {
+        seed_thread_stream(options.seed, thread);
+
+        Search::Searcher searcher;
+        searcher.initialize(1);  // Initialize with 1 thread always for datagen
+
+        while (true) {
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&] {
+                    return stop || pending[thread].size() < MAX_PENDING;
+                });
+                if (stop) {
+                    return;
+                }
+            }
+
+            std::optional<Position> pos = generate_opening(searcher, book, options.rand_moves);
+            if (!pos) {
+                continue;
+            }
+
+            std::lock_guard lock{mutex};
+            pending[thread].push_back(*pos);
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (usize t = 0; t < thread_count; t++) {
+        threads.emplace_back(generate, t);
+    }
+
+    // Take one candidate from each thread in turn. Each thread's sequence is fixed by its stream,
+    // so dropping duplicates here gives the same output whatever the threads' relative speed.
+    std::unordered_set<HashKey> seen;
+    usize                       generated = 0;
+    for (usize t = 0; generated < options.count; t = (t + 1) % thread_count) {
+        Position pos = [&] {
+            std::unique_lock lock{mutex};
+            cv.wait(lock, [&] {
+                return !pending[t].empty();
+            });
+            Position front = pending[t].front();
+            pending[t].pop_front();
+            cv.notify_all();
+            return front;
+        }();
+
+        if (!seen.insert(pos.get_hash_key()).second) {
+            continue;
+        }
+
+        std::cout << "info string genfens " << pos << std::endl;
+        generated++;
+    }
+
+    {
+        std::lock_guard lock{mutex};
+        stop = true;
+    }
+    cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace Genfens
+}  // namespace Clockwork
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "position.hpp"
+#include "util/types.hpp"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Clockwork {
+
+namespace Search {
+class Searcher;
+}
+
+namespace Genfens {
+
+struct GenfensOptions {
+    usize                    count      = 0;
+    u64                      seed       = 0;
+    usize                    threads    = 1;
+    i32                      rand_moves = 4;
+    std::vector<std::string> book;  // Starting lines, the start position when empty
+};
+
+// Seeds the calling thread's Random with its own stream. Thread 0 gets the stream a single-threaded
+// run has always used.
+void seed_thread_stream(u64 seed, usize thread);
+
+// Plays random moves from a random book line and keeps the result if a short verification search
+// does not find it lost for either side.
+std::optional<Position> generate_opening(Search::Searcher&               searcher,
+                                         const std::vector<std::string>& book,
+                                         i32                             rand_moves);
+
+// Generates `count` distinct opening positions. Each thread plays random moves with its own
+// seed-derived Random stream and verifies candidates with its own searcher. Threads' candidates are
+// interleaved round-robin, so the output only depends on the seed and the thread count.
+void genfens(const GenfensOptions& options);
+
+}  // namespace Genfens
+}  // namespace Clockwork
@@ -25,9 +25,10 @@ i32 History::get_conthist(const Position& pos, Move move, i32 ply, Search::Stack
     return stats;
 }
 
-i32 History::get_quiet_stats(const Position& pos, Move move, i32 ply, Search::Stack* ss) const {
-    auto to_attacked   = pos.is_square_attacked_by(move.to(), ~pos.active_color());
-    auto from_attacked = pos.is_square_attacked_by(move.from(), ~pos.active_color());
+i32 History::get_quiet_stats(
+  const Position& pos, Bitboard threats, Move move, i32 ply, Search::Stack* ss) const {
+    auto to_attacked   = threats.is_set(move.to());
+    auto from_attacked = threats.is_set(move.from());
     i32  stats         = m_main_hist[static_cast<usize>(pos.active_color())][move.from_to()]
                            [from_attacked * 2 + to_attacked];
     stats += 2 * get_conthist(pos, move, ply, ss);
@@ -63,10 +64,14 @@ void History::update_cont_hist(
 }
 
 
-void History::update_quiet_stats(
-  const Position& pos, Move move, i32 ply, Search::Stack* ss, i32 bonus) {
-    auto  to_attacked   = pos.is_square_attacked_by(move.to(), ~pos.active_color());
-    auto  from_attacked = pos.is_square_attacked_by(move.from(), ~pos.active_color());
+void History::update_quiet_stats(const Position& pos,
+                                 Bitboard        threats,
+                                 Move            move,
+                                 i32             ply,
+                                 Search::Stack*  ss,
+                                 i32             bonus) {
+    auto  to_attacked   = threats.is_set(move.to());
+    auto  from_attacked = threats.is_set(move.from());
     usize stm_idx       = static_cast<usize>(pos.active_color());
     update_hist_entry(m_main_hist[stm_idx][move.from_to()][from_attacked * 2 + to_attacked], bonus);
     update_cont_hist(pos, move, ply, ss, bonus / 2);
@@ -35,9 +35,17 @@ public:
     }
 
     i32  get_conthist(const Position& pos, Move move, i32 ply, Search::Stack* ss) const;
-    i32  get_quiet_stats(const Position& pos, Move move, i32 ply, Search::Stack* ss) const;
     void update_cont_hist(const Position& pos, Move move, i32 ply, Search::Stack* ss, i32 bonus);
-    void update_quiet_stats(const Position& pos, Move move, i32 ply, Search::Stack* ss, i32 bonus);
+
+    // `threats` are the squares the opponent attacks, from the node's attack summary.
+    i32 get_quiet_stats(
+      const Position& pos, Bitboard threats, Move move, i32 ply, Search::Stack* ss) const;
+    void update_quiet_stats(const Position& pos,
+                            Bitboard        threats,
+                            Move            move,
+                            i32             ply,
+                            Search::Stack*  ss,
+                            i32             bonus);
 
     i32  get_noisy_stats(const Position& pos, Move move) const;
     void update_noisy_stats(const Position& pos, Move move, i32 bonus);
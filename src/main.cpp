@@ -1,4 +1,5 @@
 #include "cuckoo.hpp"
+#include "endgame.hpp"
 #include "uci.hpp"
 #include "zobrist.hpp"
 
@@ -9,6 +10,7 @@ int main(int argc, char* argv[]) {
     // Initialize all necessary tables (TODO: we may need to move this to a dedicated file)
     Zobrist::init_zobrist_keys();
     Cuckoo::init();
+    Endgame::init();
 
     UCI::UCIHandler uci;
 
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "endgame.hpp"
+#include "util/types.hpp"
+#include <array>
+
+namespace Clockwork {
+
+// Evaluation data that only depends on the material signature.
+struct MaterialEntry {
+    HashKey key   = 0;
+    bool    valid = false;
+
+    i32 white_phase = 0;
+    i32 black_phase = 0;
+    i32 phase       = 0;
+
+    Endgame::Match endgame{};
+};
+
+class MaterialTable {
+public:
+    static constexpr usize SIZE_BITS = 10;
+    static constexpr usize SIZE      = usize{1} << SIZE_BITS;
+
+    // On a miss the entry is reset, and the caller is expected to fill it in.
+    MaterialEntry& probe(HashKey key) {
+        // Material keys are packed counts rather than random bits, so mix them before indexing
+        usize          idx   = static_cast<usize>((key * 0x9E3779B97F4A7C15) >> (64 - SIZE_BITS));
+        MaterialEntry& entry = m_entries[idx];
+        if (entry.valid && entry.key == key) {
+            return entry;
+        }
+        entry     = {};
+        entry.key = key;
+        return entry;
+    }
+
+private:
+    std::array<MaterialEntry, SIZE> m_entries{};
+};
+
+}  // namespace Clockwork
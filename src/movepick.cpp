@@ -52,14 +52,15 @@ Move MovePicker::next() {
 
             // ProbCut: Check SEE against fixed threshold
             if (m_threshold) {
-                if (SEE::see(m_pos, curr, *m_threshold)) {
+                if (SEE::see(m_pos, curr, *m_threshold, m_attacks.get(m_pos))) {
                     return curr;
                 }
                 continue;  // In ProbCut, we discard bad noisy moves immediately
             }
 
             // Normal: Check SEE for pruning
-            if (SEE::see(m_pos, curr, -score / tuned::movepicker_see_capthist_divisor)) {
+            if (SEE::see(m_pos, curr, -score / tuned::movepicker_see_capthist_divisor,
+                         m_attacks.get(m_pos))) {
                 return curr;
             } else {
                 m_bad_noisy.push_back(curr);
@@ -183,7 +184,9 @@ Move RandomMovePicker::next() {
 template<bool quiets>
 i32 MovePicker::score_move(Move move) const {
     if constexpr (quiets) {
-        return m_history.get_quiet_stats(m_pos, move, m_ply, m_stack);
+        const Bitboard threats =
+          m_attacks.get(m_pos).any[static_cast<usize>(~m_pos.active_color())];
+        return m_history.get_quiet_stats(m_pos, threats, move, m_ply, m_stack);
     } else {
         if (!move.is_promotion()) {
             constexpr int MVV[6] = {0, 800, 2400, 2400, 4800, 7200};
@@ -13,10 +13,15 @@ bool quiet_move(Move move);
 
 class MovePicker {
 public:
-    explicit MovePicker(
-      const Position& pos, const History& history, Move tt_move, i32 ply, Search::Stack* ss) :
+    explicit MovePicker(const Position&     pos,
+                        const History&      history,
+                        AttackSummaryCache& attacks,
+                        Move                tt_move,
+                        i32                 ply,
+                        Search::Stack*      ss) :
         m_pos(pos),
         m_history(history),
+        m_attacks(attacks),
         m_movegen(pos),
         m_tt_move(tt_move),
         m_killer(ss->killer),
@@ -25,12 +30,14 @@ public:
     }
 
     // for ProbCut
-    explicit MovePicker(const Position& pos,
-                        const History&  history,
-                        Move            tt_move,
-                        Value           threshold) :
+    explicit MovePicker(const Position&     pos,
+                        const History&      history,
+                        AttackSummaryCache& attacks,
+                        Move                tt_move,
+                        Value               threshold) :
         m_pos(pos),
         m_history(history),
+        m_attacks(attacks),
         m_movegen(pos),
         m_tt_move(tt_move),
         m_killer(Move::none()),
@@ -82,6 +89,7 @@ private:
 
     const Position&      m_pos;
     const History&       m_history;
+    AttackSummaryCache&  m_attacks;
     MoveGen              m_movegen;
     MoveList             m_noisy;
     MoveList             m_quiet;
@@ -0,0 +1,282 @@
+#include "numa.hpp"
+#include "util/parse.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace Clockwork::Numa {
+
+bool enabled = false;
+
+usize Topology::cpu_count() const {
+    usize count = 0;
+    for (const Node& node : nodes) {
+        count += node.cpus.size();
+    }
+    return count;
+}
+
+std::optional<std::vector<usize>> parse_cpu_list(std::string_view str) {
+    std::vector<usize> cpus;
+
+    while (!str.empty() && (str.back() == '\n' || str.back() == ' ')) {
+        str.remove_suffix(1);
+    }
+
+    while (!str.empty()) {
+        usize            comma = str.find(',');
+        std::string_view range = str.substr(0, comma);
+        str                    = comma == std::string_view::npos ? "" : str.substr(comma + 1);
+
+        usize dash  = range.find('-');
+        auto  first = parse_number<usize>(range.substr(0, dash));
+        auto  last =
+          dash == std::string_view::npos ? first : parse_number<usize>(range.substr(dash + 1));
+        if (!first || !last || *last < *first) {
+            return std::nullopt;
+        }
+        for (usize cpu = *first; cpu <= *last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+#ifdef __linux__
+// Cpus the process may run on, captured before any thread gets pinned.
+static const cpu_set_t& allowed_cpus() {
+    static const cpu_set_t allowed = [] {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            for (usize cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return set;
+    }();
+    return allowed;
+}
+#endif
+
+static Topology read_topology() {
+    Topology topology;
+
+#ifdef __linux__
+    namespace fs = std::filesystem;
+
+    const fs::path  root = "/sys/devices/system/node";
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(root, ec)) {
+        std::string name = entry.path().filename().string();
+        if (!name.starts_with("node")) {
+            continue;
+        }
+        auto id = parse_number<usize>(std::string_view{name}.substr(4));
+        if (!id) {
+            continue;
+        }
+
+        std::ifstream file{entry.path() / "cpulist"};
+        std::string   list;
+        std::getline(file, list);
+        auto cpus = parse_cpu_list(list);
+        if (!cpus) {
+            continue;
+        }
+
+        // Memory-only nodes and cpus outside of our affinity mask are of no use to us
+        std::erase_if(*cpus, [](usize cpu) {
+            return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed_cpus());
+        });
+        if (!cpus->empty()) {
+            topology.nodes.push_back({*id, std::move(*cpus)});
+        }
+    }
+
+    std::ranges::sort(topology.nodes, {}, &Node::id);
+#endif
+
+    if (topology.nodes.empty()) {
+        std::vector<usize> cpus(std::max(1u, std::thread::hardware_concurrency()));
+        for (usize cpu = 0; cpu < cpus.size(); cpu++) {
+            cpus[cpu] = cpu;
+        }
+        topology.nodes.push_back({0, std::move(cpus)});
+    }
+
+    return topology;
+}
+
+const Topology& topology() {
+    static const Topology topology = read_topology();
+    return topology;
+}
+
+std::optional<ThreadBinding> ThreadBinding::parse(std::string_view str) {
+    if (str == "none") {
+        return ThreadBinding{};
+    }
+    if (str == "compact") {
+        return ThreadBinding{Mode::Compact, {}};
+    }
+    if (str == "scatter") {
+        return ThreadBinding{Mode::Scatter, {}};
+    }
+    auto cpus = parse_cpu_list(str);
+    if (!cpus || cpus->empty()) {
+        return std::nullopt;
+    }
+    return ThreadBinding{Mode::List, std::move(*cpus)};
+}
+
+std::string ThreadBinding::to_string() const {
+    switch (mode) {
+    case Mode::None:
+        return "none";
+    case Mode::Compact:
+        return "compact";
+    case Mode::Scatter:
+        return "scatter";
+    case Mode::List: {
+        std::string result;
+        for (usize cpu : cpus) {
+            if (!result.empty()) {
+                result += ',';
+            }
+            result += std::to_string(cpu);
+        }
+        return result;
+    }
+    }
+    return "none";
+}
+
+std::optional<usize> ThreadBinding::cpu_for_thread(usize thread_index) const {
+    const Topology& topo = topology();
+
+    switch (mode) {
+    case Mode::None:
+        return std::nullopt;
+    case Mode::Compact: {
+        usize index = thread_index % topo.cpu_count();
+        for (const Node& node : topo.nodes) {
+            if (index < node.cpus.size()) {
+                return node.cpus[index];
+            }
+            index -= node.cpus.size();
+        }
+        return std::nullopt;
+    }
+    case Mode::Scatter: {
+        const Node& node = topo.nodes[thread_index % topo.node_count()];
+        return node.cpus[(thread_index / topo.node_count()) % node.cpus.size()];
+    }
+    case Mode::List:
+        return cpus[thread_index % cpus.size()];
+    }
+    return std::nullopt;
+}
+
+usize node_for_thread(usize thread_index, usize thread_count) {
+    const Topology& topo = topology();
+
+    usize cpu = thread_index * topo.cpu_count() / std::max<usize>(thread_count, 1);
+    for (usize node = 0; node < topo.node_count(); node++) {
+        if (cpu < topo.nodes[node].cpus.size()) {
+            return node;
+        }
+        cpu -= topo.nodes[node].cpus.size();
+    }
+    return topo.node_count() - 1;
+}
+
+std::optional<usize> node_of_cpu(usize cpu) {
+    const Topology& topo = topology();
+    for (usize node = 0; node < topo.node_count(); node++) {
+        if (std::ranges::find(topo.nodes[node].cpus, cpu) != topo.nodes[node].cpus.end()) {
+            return node;
+        }
+    }
+    return std::nullopt;
+}
+
+bool bind_current_thread(usize node) {
+#ifdef __linux__
+    const Topology& topo = topology();
+    if (topo.node_count() <= 1 || node >= topo.node_count()) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (usize cpu : topo.nodes[node].cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+bool bind_current_thread_to_cpu(usize cpu) {
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+void run_on_node(usize node, const std::function<void()>& fn) {
+    std::thread thread{[&] {
+        bind_current_thread(node);
+        fn();
+    }};
+    thread.join();
+}
+
+void interleave(void* ptr, size_t bytes) {
+#ifdef __linux__
+    const Topology& topo = topology();
+    if (topo.node_count() <= 1 || ptr == nullptr || bytes == 0) {
+        return;
+    }
+
+    // Values from <numaif.h>, which belongs to libnuma
+    constexpr int      MPOL_INTERLEAVE = 3;
+    constexpr unsigned MPOL_MF_MOVE    = 1 << 1;
+    constexpr usize    BITS            = 8 * sizeof(unsigned long);
+
+    std::vector<unsigned long> mask(topo.nodes.back().id / BITS + 1);
+    for (const Node& node : topo.nodes) {
+        mask[node.id / BITS] |= 1ul << (node.id % BITS);
+    }
+
+    // Best effort: the kernel may refuse (e.g. no permission to move pages), which is harmless
+    (void)syscall(SYS_mbind, ptr, bytes, MPOL_INTERLEAVE, mask.data(), mask.size() * BITS + 1,
+                  MPOL_MF_MOVE);
+#else
+    (void)ptr;
+    (void)bytes;
+#endif
+}
+
+}  // namespace Clockwork::Numa
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "util/types.hpp"
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Clockwork::Numa {
+
+// Topology as reported by /sys/devices/system/node. When it is unavailable (other platforms,
+// restricted containers) the machine is treated as a single node and placement is a no-op.
+struct Node {
+    usize              id;
+    std::vector<usize> cpus;
+};
+
+struct Topology {
+    std::vector<Node> nodes;
+
+    [[nodiscard]] usize node_count() const {
+        return nodes.size();
+    }
+    [[nodiscard]] usize cpu_count() const;
+};
+
+// How search threads are pinned to cpus. Set through the ThreadBinding UCI option.
+struct ThreadBinding {
+    enum class Mode {
+        None,
+        Compact,
+        Scatter,
+        List,
+    };
+
+    Mode               mode = Mode::None;
+    std::vector<usize> cpus;  // Only used by Mode::List
+
+    // Accepts "none", "compact", "scatter" or an explicit cpu list such as "0-3,8".
+    static std::optional<ThreadBinding> parse(std::string_view str);
+    [[nodiscard]] std::string           to_string() const;
+
+    // Compact fills up one node before using the next, scatter alternates between nodes, and a
+    // list hands out its cpus in order. Threads wrap around when there are more than cpus.
+    [[nodiscard]] std::optional<usize> cpu_for_thread(usize thread_index) const;
+};
+
+// Whether workers are pinned to nodes and shared tables are interleaved.
+// Set through the NumaAware UCI option.
+extern bool enabled;
+
+[[nodiscard]] const Topology& topology();
+
+// Parses a sysfs cpu list such as "0-3,8-11".
+[[nodiscard]] std::optional<std::vector<usize>> parse_cpu_list(std::string_view str);
+
+// Spreads threads over the nodes in proportion to their number of cpus.
+[[nodiscard]] usize node_for_thread(usize thread_index, usize thread_count);
+
+// Index into topology().nodes of the node owning a cpu.
+[[nodiscard]] std::optional<usize> node_of_cpu(usize cpu);
+
+// Restricts the calling thread to the cpus of a node (index into topology().nodes).
+bool bind_current_thread(usize node);
+
+// Pins the calling thread to a single cpu.
+bool bind_current_thread_to_cpu(usize cpu);
+
+// Runs `fn` on a temporary thread bound to `node`, so that memory it touches first is local.
+void run_on_node(usize node, const std::function<void()>& fn);
+
+// Interleaves the pages of a page-aligned allocation over all nodes.
+void interleave(void* ptr, size_t bytes);
+
+}  // namespace Clockwork::Numa
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "util/types.hpp"
+#include <array>
+
+namespace Clockwork {
+
+// Game outcome from white's point of view
+enum class GameResult : u8 {
+    BlackWin = 0,
+    Draw     = 1,
+    WhiteWin = 2,
+};
+
+// A position in 32 bytes, laid out like marlinformat. Occupied squares are listed in `occupancy`,
+// and `pieces` holds one nibble per occupied square in ascending square order: the piece type in
+// the low three bits and the color in the high bit. Rooks that can still castle are stored with
+// type UNMOVED_ROOK.
+struct PackedPosition {
+    static constexpr u8 UNMOVED_ROOK  = 7;
+    static constexpr u8 NO_EN_PASSANT = 64;
+
+    u64                occupancy = 0;
+    std::array<u8, 16> pieces{};
+    u8                 stm_en_passant = 0;  // side to move in bit 7, en passant square below
+    u8                 halfmove_clock = 0;
+    u16                ply            = 0;
+    i16                score          = 0;  // from white's point of view
+    GameResult         result         = GameResult::Draw;
+    u8                 extra          = 0;
+
+    bool operator==(const PackedPosition&) const = default;
+};
+
+static_assert(sizeof(PackedPosition) == 32);
+
+}  // namespace Clockwork
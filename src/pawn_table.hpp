@@ -0,0 +1,53 @@
+#pragma once
+
+#include "bitboard.hpp"
+#include "eval_types.hpp"
+#include "square.hpp"
+#include "util/types.hpp"
+#include <array>
+
+namespace Clockwork {
+
+// Pawn structure terms that only depend on the pawns of both sides.
+struct PawnEntry {
+    HashKey key   = 0;
+    bool    valid = false;
+
+    // Pawn-only scores (doubled, isolated, phalanx, defended, passer rank bonus), white pov
+    PScore score{};
+
+    std::array<Bitboard, 2> passed{};
+    std::array<Bitboard, 2> attacks{};
+    std::array<Bitboard, 2> span_attacks{};
+    std::array<Bitboard, 2> files{};
+
+    // King shelter only depends on pawns and the king square, so it is cached lazily per side.
+    std::array<Square, 2> shelter_king_sq{Square::invalid(), Square::invalid()};
+    std::array<PScore, 2> shelter{};
+};
+
+class PawnTable {
+public:
+    static constexpr usize SIZE = 8192;
+
+    u64 hits   = 0;
+    u64 misses = 0;
+
+    // On a miss the entry is reset, and the caller is expected to fill it in.
+    PawnEntry& probe(HashKey key) {
+        PawnEntry& entry = m_entries[static_cast<usize>(key % SIZE)];
+        if (entry.valid && entry.key == key) {
+            hits++;
+            return entry;
+        }
+        misses++;
+        entry     = {};
+        entry.key = key;
+        return entry;
+    }
+
+private:
+    std::array<PawnEntry, SIZE> m_entries{};
+};
+
+}  // namespace Clockwork
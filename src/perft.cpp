@@ -1,14 +1,76 @@
+#include "perft.hpp"
 #include "movegen.hpp"
 #include "position.hpp"
 #include "util/ios_fmt_guard.hpp"
+#include "util/mem.hpp"
 #include "util/types.hpp"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+    #include <time.h>
+#endif
 
 namespace Clockwork {
 
+// Lockless table of subtree counts keyed by position and depth. Each entry keeps its key xor-ed
+// with the count, so an entry torn by two threads writing at once fails verification instead of
+// producing a wrong count.
+class PerftTable {
+public:
+    explicit PerftTable(usize mb) :
+        m_size{std::max<usize>(1, mb * 1024 * 1024 / sizeof(Entry))},
+        m_entries{make_unique_huge_page<Entry[]>(m_size)} {
+    }
+
+    [[nodiscard]] std::optional<u64> probe(HashKey key, usize depth) const {
+        u64          check = mix(key, depth);
+        const Entry& entry = m_entries[index(check)];
+        u64          nodes = entry.nodes.load(std::memory_order_relaxed);
+        if ((entry.check.load(std::memory_order_relaxed) ^ nodes) != check) {
+            return std::nullopt;
+        }
+        return nodes;
+    }
+
+    void store(HashKey key, usize depth, u64 nodes) {
+        u64    check = mix(key, depth);
+        Entry& entry = m_entries[index(check)];
+        entry.check.store(check ^ nodes, std::memory_order_relaxed);
+        entry.nodes.store(nodes, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<u64> check;
+        std::atomic<u64> nodes;
+    };
+
+    usize                         m_size;
+    unique_ptr_huge_page<Entry[]> m_entries;
+
+    static u64 mix(HashKey key, usize depth) {
+        return key ^ (static_cast<u64>(depth) * 0x9E3779B97F4A7C15);
+    }
+
+    [[nodiscard]] usize index(u64 check) const {
+        return static_cast<usize>((static_cast<u128>(check) * m_size) >> 64);
+    }
+};
+
+struct PerftContext {
+    PerftTable* table  = nullptr;
+    u64         probes = 0;
+    u64         hits   = 0;
+};
+
 template<bool print>
-static u64 core(const Position& position, usize depth) {
+static u64 core(const Position& position, usize depth, PerftContext& ctx) {
     if (depth == 0) {
         return 1;
     }
@@ -23,12 +85,20 @@ static u64 core(const Position& position, usize depth) {
         return moves.size();
     }
 
+    if (ctx.table) {
+        ctx.probes++;
+        if (auto nodes = ctx.table->probe(position.get_hash_key(), depth)) {
+            ctx.hits++;
+            return *nodes;
+        }
+    }
+
     for (Move m : moves) {
         assert(movegen.is_legal(m));
 
         Position new_position = position.move(m);
 
-        u64 child = core<false>(new_position, depth - 1);
+        u64 child = core<false>(new_position, depth - 1, ctx);
 
         if constexpr (print) {
             std::cout << m << ": " << child << std::endl;
@@ -37,19 +107,137 @@ static u64 core(const Position& position, usize depth) {
         result += child;
     }
 
+    if (ctx.table) {
+        ctx.table->store(position.get_hash_key(), depth, result);
+    }
+
     return result;
 }
 
 u64 perft(const Position& position, usize depth) {
-    return core<false>(position, depth);
+    PerftContext ctx;
+    return core<false>(position, depth, ctx);
 }
 
-void split_perft(const Position& position, usize depth) {
+// Cpu time used by the calling thread, so that threads waiting for a core do not count as busy.
+static f64 thread_cpu_seconds() {
+#ifdef __linux__
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return static_cast<f64>(ts.tv_sec) + static_cast<f64>(ts.tv_nsec) * 1e-9;
+    }
+#endif
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct ParallelPerft {
+    MoveList         root_moves;
+    std::vector<u64> root_counts;
+    u64              total        = 0;
+    u64              probes       = 0;
+    u64              hits         = 0;
+    f64              busy_seconds = 0.0;
+};
+
+// Every subtree below ply 2 (or ply 1 for shallow perfts) is one task. Threads claim the next
+// unfinished task from a shared counter, so a thread that runs out of work picks up the remaining
+// subtrees while the others are still busy with large ones.
+static ParallelPerft parallel_perft(const Position&     position,
+                                    usize               depth,
+                                    const PerftOptions& options) {
+    struct Task {
+        usize    root;
+        Position position;
+        usize    depth;
+    };
+
+    ParallelPerft result;
+
+    MoveGen movegen{position};
+    movegen.generate_moves(result.root_moves, result.root_moves);
+    result.root_counts.assign(result.root_moves.size(), 0);
+
+    std::vector<Task> tasks;
+    for (usize i = 0; i < result.root_moves.size(); i++) {
+        Position child = position.move(result.root_moves[i]);
+        if (depth < 3) {
+            tasks.push_back({i, child, depth - 1});
+            continue;
+        }
+
+        MoveList child_moves;
+        MoveGen  child_movegen{child};
+        child_movegen.generate_moves(child_moves, child_moves);
+        for (Move m : child_moves) {
+            tasks.push_back({i, child.move(m), depth - 2});
+        }
+    }
+
+    std::optional<PerftTable> table;
+    if (options.hash_mb > 0) {
+        table.emplace(options.hash_mb);
+    }
+
+    usize                     thread_count = std::max<usize>(1, options.threads);
+    std::vector<u64>          task_counts(tasks.size());
+    std::vector<PerftContext> contexts(thread_count);
+    std::vector<f64>          busy(thread_count);
+    std::atomic<usize>        next_task{0};
+
+    std::vector<std::thread> threads;
+    for (usize t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            PerftContext& ctx = contexts[t];
+            ctx.table         = table ? &*table : nullptr;
+
+            f64 start = thread_cpu_seconds();
+            for (usize i = next_task.fetch_add(1); i < tasks.size(); i = next_task.fetch_add(1)) {
+                task_counts[i] = core<false>(tasks[i].position, tasks[i].depth, ctx);
+            }
+            busy[t] = thread_cpu_seconds() - start;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (usize i = 0; i < tasks.size(); i++) {
+        result.root_counts[tasks[i].root] += task_counts[i];
+        result.total += task_counts[i];
+    }
+    for (usize t = 0; t < thread_count; t++) {
+        result.probes += contexts[t].probes;
+        result.hits += contexts[t].hits;
+        result.busy_seconds += busy[t];
+    }
+
+    return result;
+}
+
+u64 perft(const Position& position, usize depth, const PerftOptions& options) {
+    if (depth < 2) {
+        return perft(position, depth);
+    }
+    return parallel_perft(position, depth, options).total;
+}
+
+void split_perft(const Position& position, usize depth, const PerftOptions& options) {
     IosFmtGuard guard{std::cout};
 
     auto start_time = std::chrono::steady_clock::now();
 
-    u64 total = core<true>(position, depth);
+    u64                          total = 0;
+    std::optional<ParallelPerft> parallel;
+    if (depth < 2 || (options.threads <= 1 && options.hash_mb == 0)) {
+        PerftContext ctx;
+        total = core<true>(position, depth, ctx);
+    } else {
+        parallel = parallel_perft(position, depth, options);
+        for (usize i = 0; i < parallel->root_moves.size(); i++) {
+            std::cout << parallel->root_moves[i] << ": " << parallel->root_counts[i] << std::endl;
+        }
+        total = parallel->total;
+    }
     std::cout << "total: " << total << std::endl;
 
     std::chrono::duration<f64> elapsed    = std::chrono::steady_clock::now() - start_time;
@@ -59,6 +247,19 @@ void split_perft(const Position& position, usize depth) {
     std::cout << std::setprecision(1) << std::fixed;
     std::cout << "perft to depth " << depth << " complete in " << elapsed_ms << "ms (" << mnps
               << " Mnps)" << std::endl;
+
+    if (parallel) {
+        usize thread_count = std::max<usize>(1, options.threads);
+        std::cout << "threads: " << thread_count << " (" << mnps / static_cast<f64>(thread_count)
+                  << " Mnps per thread, " << parallel->busy_seconds / elapsed.count()
+                  << "x parallelism)" << std::endl;
+    }
+    if (parallel && options.hash_mb > 0) {
+        f64 hitrate = parallel->probes > 0 ? static_cast<f64>(parallel->hits) * 100.0
+                                               / static_cast<f64>(parallel->probes)
+                                           : 0.0;
+        std::cout << "hash: " << options.hash_mb << " MB (" << hitrate << "% hits)" << std::endl;
+    }
 }
 
 }  // namespace Clockwork
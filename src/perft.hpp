@@ -5,8 +5,17 @@
 
 namespace Clockwork {
 
+struct PerftOptions {
+    usize threads = 1;
+    usize hash_mb = 0;  // 0 disables the perft transposition table
+};
+
 u64 perft(const Position& position, usize depth);
 
-void split_perft(const Position& position, usize depth);
+// Splits the tree below ply 2 over `options.threads` threads, sharing a lockless table of subtree
+// counts when `options.hash_mb` is set.
+u64 perft(const Position& position, usize depth, const PerftOptions& options);
+
+void split_perft(const Position& position, usize depth, const PerftOptions& options = {});
 
 }  // namespace Clockwork
@@ -347,6 +347,8 @@ Position Position::move(Move m, PsqtState* psqtState, const TT* tt) const {
         new_pos.m_piece_list_sq[!color][dst.id()] = Square::invalid();
         new_pos.m_piece_list[!color][dst.id()]    = PieceType::None;
 
+        new_pos.m_material_key -= material_key_delta(dst.color(), dst.ptype());
+
         new_pos.m_50mr = 0;
         CHECK_SRC_CASTLING_RIGHTS();
         CHECK_DST_CASTLING_RIGHTS();
@@ -386,6 +388,8 @@ Position Position::move(Move m, PsqtState* psqtState, const TT* tt) const {
         new_pos.m_piece_list_sq[!color][victim.id()] = Square::invalid();
         new_pos.m_piece_list[!color][victim.id()]    = PieceType::None;
 
+        new_pos.m_material_key -= material_key_delta(victim.color(), PieceType::Pawn);
+
         new_pos.m_50mr = 0;
         break;
     }
@@ -400,6 +404,9 @@ Position Position::move(Move m, PsqtState* psqtState, const TT* tt) const {
         new_pos.m_piece_list_sq[color][src.id()] = to;
         new_pos.m_piece_list[color][src.id()]    = *m.promo();
 
+        new_pos.m_material_key += material_key_delta(m_active_color, *m.promo())
+                                - material_key_delta(m_active_color, PieceType::Pawn);
+
         new_pos.m_50mr = 0;
         break;
     }
@@ -417,6 +424,10 @@ Position Position::move(Move m, PsqtState* psqtState, const TT* tt) const {
         new_pos.m_piece_list_sq[!color][dst.id()] = Square::invalid();
         new_pos.m_piece_list[!color][dst.id()]    = PieceType::None;
 
+        new_pos.m_material_key += material_key_delta(m_active_color, *m.promo())
+                                - material_key_delta(m_active_color, PieceType::Pawn)
+                                - material_key_delta(dst.color(), dst.ptype());
+
         new_pos.m_50mr = 0;
         CHECK_DST_CASTLING_RIGHTS();
         break;
@@ -440,7 +451,7 @@ Position Position::move(Move m, PsqtState* psqtState, const TT* tt) const {
     new_pos.m_ply++;
 
     if constexpr (UPDATE_PSQT) {
-        psqtState->apply_updates(new_pos, updates);
+        psqtState->defer_updates(new_pos, updates);
     }
 
     return new_pos;
@@ -567,6 +578,25 @@ const std::array<PieceMask, 2> Position::calc_attacks_slow(Square sq) {
     };
 }
 
+AttackSummary::AttackSummary(const Position& pos) {
+    for (Color color : {Color::White, Color::Black}) {
+        const usize     c     = static_cast<usize>(color);
+        const Wordboard wb    = pos.attack_table(color);
+        const auto&     plist = pos.piece_list(color);
+
+        u16x64 minus_one    = wb.raw - u16x64::splat(1u);
+        u16x64 at_least_two = wb.raw & minus_one;
+
+        any[c]         = wb.get_attacked_bitboard();
+        two_or_more[c] = Bitboard{at_least_two.nonzeros().to_bits()};
+
+        for (PieceType ptype : {PieceType::Pawn, PieceType::Knight, PieceType::Bishop,
+                                PieceType::Rook, PieceType::Queen, PieceType::King}) {
+            by_pt[c][static_cast<usize>(ptype)] = wb.get_piece_mask_bitboard(plist.mask_eq(ptype));
+        }
+    }
+}
+
 Wordboard Position::create_attack_table_superpiece_mask(Square                   sq,
                                                         CreateSuperpieceMaskInfo cmi_arg) const {
     auto [ray_coords, ray_valid] = geometry::superpiece_rays(sq);
@@ -834,11 +864,147 @@ std::optional<Position> Position::parse(std::string_view board,
         return std::nullopt;
     }
 
-    result.m_attack_table = result.calc_attacks_slow();
+    result.init_slow_state();
+
+    return result;
+}
+
+void Position::init_attack_tables() {
+    m_attack_table = {};
+    for (bool color : {false, true}) {
+        for (u8 id = 0; id < 0x10; id++) {
+            add_attacks(color, PieceId{id}, m_piece_list_sq[color].array[id],
+                        m_piece_list[color].array[id]);
+        }
+    }
+}
+
+void Position::init_slow_state() {
+    init_attack_tables();
     // Initialize ZobristInfo
-    result.m_zobrist_info = ZobristInfo(result.calc_hash_key_slow(), result.calc_pawn_key_slow(),
-                                        result.calc_non_pawn_key_slow(),
-                                        result.calc_major_key_slow(), result.calc_minor_key_slow());
+    m_zobrist_info = ZobristInfo(calc_hash_key_slow(), calc_pawn_key_slow(),
+                                 calc_non_pawn_key_slow(), calc_major_key_slow(),
+                                 calc_minor_key_slow());
+    m_material_key = calc_material_key_slow();
+}
+
+PackedPosition Position::pack() const {
+    PackedPosition packed;
+
+    Bitboard occupied = m_board.get_occupied_bitboard();
+    packed.occupancy  = occupied.value();
+
+    usize index = 0;
+    for (Square sq : occupied) {
+        Place    p         = m_board[sq];
+        RookInfo rook_info = m_rook_info[static_cast<usize>(p.color())];
+        bool     unmoved   = rook_info.aside == sq || rook_info.hside == sq;
+        u8       type      = unmoved ? PackedPosition::UNMOVED_ROOK : static_cast<u8>(p.ptype());
+        u8       code      = static_cast<u8>((static_cast<u8>(p.color()) << 3) | type);
+
+        packed.pieces[index / 2] |= static_cast<u8>(code << (4 * (index % 2)));
+        index++;
+    }
+
+    u8 enpassant = m_enpassant.is_valid() ? m_enpassant.raw : PackedPosition::NO_EN_PASSANT;
+    packed.stm_en_passant = static_cast<u8>((static_cast<u8>(m_active_color) << 7) | enpassant);
+    packed.halfmove_clock = static_cast<u8>(m_50mr);
+    packed.ply            = m_ply;
+
+    return packed;
+}
+
+std::optional<Position> Position::unpack(const PackedPosition& packed) {
+    Position result{};
+
+    Bitboard occupied{packed.occupancy};
+    if (occupied.popcount() > 32) {
+        return std::nullopt;
+    }
+
+    std::array<u8, 64> codes{};
+    usize              index = 0;
+    for (Square sq : occupied) {
+        codes[sq.raw] = static_cast<u8>((packed.pieces[index / 2] >> (4 * (index % 2))) & 0xF);
+        index++;
+    }
+
+    // Place pieces in the same order as parse does, so that piece ids come out the same
+    std::array<u8, 2>   id       = {1, 1};
+    std::array<bool, 2> has_king = {false, false};
+    Bitboard            unmoved{};
+    for (i32 rank = 7; rank >= 0; rank--) {
+        for (i32 file = 0; file < 8; file++) {
+            Square sq = Square::from_file_and_rank(file, rank);
+            if (!occupied.is_set(sq)) {
+                continue;
+            }
+
+            Color color = static_cast<Color>(codes[sq.raw] >> 3);
+            u8    type  = codes[sq.raw] & 0x7;
+            if (type == static_cast<u8>(PieceType::None)) {
+                return std::nullopt;
+            }
+            if (type == PackedPosition::UNMOVED_ROOK) {
+                unmoved |= Bitboard::from_square(sq);
+                type = static_cast<u8>(PieceType::Rook);
+            }
+            PieceType ptype = static_cast<PieceType>(type);
+
+            usize c          = static_cast<usize>(color);
+            u8    current_id = 0;
+            if (ptype == PieceType::King) {
+                if (has_king[c]) {
+                    return std::nullopt;
+                }
+                has_king[c] = true;
+            } else {
+                if (id[c] >= 0x10) {
+                    return std::nullopt;
+                }
+                current_id = id[c]++;
+            }
+
+            result.m_board.mailbox[sq.raw]              = Place{color, ptype, PieceId{current_id}};
+            result.m_piece_list_sq[c].array[current_id] = sq;
+            result.m_piece_list[c].array[current_id]    = ptype;
+        }
+    }
+    if (!has_king[0] || !has_king[1]) {
+        return std::nullopt;
+    }
+
+    // Castling rights
+    for (Square sq : unmoved) {
+        Color color = result.m_board[sq].color();
+        if (sq.rank() != color_backrank(color)) {
+            return std::nullopt;
+        }
+        RookInfo& rook_info = result.m_rook_info[static_cast<usize>(color)];
+        if (sq.file() < result.king_sq(color).file()) {
+            rook_info.aside = sq;
+        } else {
+            rook_info.hside = sq;
+        }
+    }
+
+    result.m_active_color = static_cast<Color>(packed.stm_en_passant >> 7);
+
+    u8 enpassant = packed.stm_en_passant & 0x7F;
+    if (enpassant != PackedPosition::NO_EN_PASSANT) {
+        if (enpassant > 63) {
+            return std::nullopt;
+        }
+        result.m_enpassant = Square{enpassant};
+    }
+
+    if (packed.halfmove_clock > 100) {
+        return std::nullopt;
+    }
+    result.m_50mr = packed.halfmove_clock;
+    result.m_ply  = packed.ply;
+
+    result.init_slow_state();
 
     return result;
 }
@@ -930,6 +1096,18 @@ HashKey Position::calc_minor_key_slow() const {
     return key;
 }
 
+HashKey Position::calc_material_key_slow() const {
+    HashKey key = 0;
+    for (usize sq_idx = 0; sq_idx < 64; sq_idx++) {
+        Place p = m_board.mailbox[sq_idx];
+        if (p.is_empty()) {
+            continue;
+        }
+        key += material_key_delta(p.color(), p.ptype());
+    }
+    return key;
+}
+
 std::ostream& operator<<(std::ostream& os, const Position& position) {
     i32  blanks      = 0;
     auto emit_blanks = [&] {
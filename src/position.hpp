@@ -2,6 +2,7 @@
 
 #include "board.hpp"
 #include "move.hpp"
+#include "packed_position.hpp"
 #include "square.hpp"
 #include "tt.hpp"
 #include "util/types.hpp"
@@ -97,6 +98,47 @@ struct CreateSuperpieceMaskInfo {
 };
 static_assert(sizeof(CreateSuperpieceMaskInfo) == 16);
 
+// The material key packs the piece count of every (color, piece type) pair into 4 bits, kings
+// excluded. It is updated additively, so equal keys always mean equal material.
+constexpr HashKey material_key_delta(Color color, PieceType ptype) {
+    if (ptype == PieceType::King || ptype == PieceType::None) {
+        return 0;
+    }
+    return HashKey{1} << (4 * (5 * static_cast<usize>(color) + static_cast<usize>(ptype) - 1));
+}
+
+constexpr i32 material_key_count(HashKey key, Color color, PieceType ptype) {
+    return static_cast<i32>(
+      (key >> (4 * (5 * static_cast<usize>(color) + static_cast<usize>(ptype) - 1))) & 0xF);
+}
+
+struct Position;
+
+// Attack bitboards derived from a position's attack tables, built in one pass over both tables.
+struct AttackSummary {
+    std::array<Bitboard, 2>                any{};
+    std::array<Bitboard, 2>                two_or_more{};
+    std::array<std::array<Bitboard, 7>, 2> by_pt{};
+
+    AttackSummary() = default;
+    explicit AttackSummary(const Position& pos);
+};
+
+// An AttackSummary built on first use. Search keeps one per node, outside of the position so
+// copies stay small, and evaluation, move ordering and SEE all read that single copy.
+struct AttackSummaryCache {
+    AttackSummary summary;
+    bool          valid = false;
+
+    const AttackSummary& get(const Position& pos) {
+        if (!valid) [[unlikely]] {
+            summary = AttackSummary{pos};
+            valid   = true;
+        }
+        return summary;
+    }
+};
+
 struct Position {
 public:
     constexpr Position() = default;
@@ -137,6 +179,9 @@ public:
     [[nodiscard]] inline HashKey get_minor_key() const {
         return m_zobrist_info.minor_key();
     }
+    [[nodiscard]] inline HashKey get_material_key() const {
+        return m_material_key;
+    }
 
     [[nodiscard]] Square king_sq(Color color) const {
         return piece_list_sq(color)[PieceId{0}];
@@ -200,6 +245,10 @@ public:
         return attack_table(color).read(sq).is_set(id);
     }
 
+    [[nodiscard]] Bitboard attacked_by(Color color) const {
+        return attack_table(color).get_attacked_bitboard();
+    }
+
     [[nodiscard]] Bitboard attacked_by(Color color, PieceType ptype) const {
         return attack_table(color).get_piece_mask_bitboard(piece_list(color).mask_eq(ptype));
     }
@@ -315,6 +364,7 @@ public:
     [[nodiscard]] std::array<HashKey, 2> calc_non_pawn_key_slow() const;
     [[nodiscard]] HashKey                calc_major_key_slow() const;
     [[nodiscard]] HashKey                calc_minor_key_slow() const;
+    [[nodiscard]] HashKey                calc_material_key_slow() const;
 
     static std::optional<Position> parse(std::string_view str);
     static std::optional<Position> parse(std::string_view board,
@@ -324,6 +374,10 @@ public:
                                          std::string_view irreversible_clock,
                                          std::string_view ply);
 
+    // Score and result are left for the caller to fill in
+    [[nodiscard]] PackedPosition    pack() const;
+    static std::optional<Position> unpack(const PackedPosition& packed);
+
     bool                 operator==(const Position&) const = default;
     friend std::ostream& operator<<(std::ostream& os, const Position& position);
 
@@ -338,8 +392,16 @@ private:
     Square                              m_enpassant = Square::invalid();
     std::array<RookInfo, 2>             m_rook_info;
 
+    HashKey                           m_material_key{};
     [[no_unique_address]] ZobristInfo m_zobrist_info;
 
+    // Builds the attack tables piece by piece. Gives the same tables as calc_attacks_slow, which
+    // scans all 64 squares and costs many times more.
+    void init_attack_tables();
+
+    // Derives attack tables and keys from the board, once setup by parse or unpack is complete
+    void init_slow_state();
+
     void incrementally_remove_piece(bool color, PieceId id, Square sq, PsqtUpdates& updates);
     void incrementally_add_piece(bool color, Place p, Square sq, PsqtUpdates& updates);
     void incrementally_mutate_piece(
@@ -7,6 +7,8 @@
 #include "square.hpp"
 #include "util/static_vector.hpp"
 #include <bit>
+#include <cassert>
+#include <span>
 
 namespace Clockwork {
 
@@ -20,15 +22,33 @@ struct PsqtUpdates {
     StaticVector<Update, 2> removes;
 };
 
+// Per-thread cache of the last accumulator seen for every (color, king side) bucket, together
+// with the pieces it was computed from. Rebuilding an accumulator after a king changes sides
+// then only needs to apply the difference between the cached and the current pieces.
+struct PsqtRefreshCache {
+    struct Entry {
+        PScore                  accumulator{};
+        std::array<Bitboard, 6> pieces{};
+    };
+
+    std::array<std::array<Entry, 2>, 2> entries{};
+
+    Entry& entry(Color color, bool king_side) {
+        return entries[static_cast<usize>(color)][static_cast<usize>(king_side)];
+    }
+};
+
 struct PsqtState {
 public:
     PsqtState() = default;
     PsqtState(const Position& pos) {
         for (Color c : {Color::White, Color::Black}) {
-            m_accumulators[static_cast<usize>(c)] = PSCORE_ZERO;
-            m_king_sides[static_cast<usize>(c)]   = pos.king_side(c);
-            auto& pieces                          = pos.piece_list(c);
-            auto& squares                         = pos.piece_list_sq(c);
+            m_accumulators[static_cast<usize>(c)]  = PSCORE_ZERO;
+            m_king_sides[static_cast<usize>(c)]    = pos.king_side(c);
+            m_computed[static_cast<usize>(c)]      = true;
+            m_needs_refresh[static_cast<usize>(c)] = false;
+            auto& pieces                           = pos.piece_list(c);
+            auto& squares                          = pos.piece_list_sq(c);
 
             for (u8 i = 0; i < 16; i++) {
                 PieceType pt = pieces[i];
@@ -41,34 +61,59 @@ public:
         }
     }
 
-    void apply_updates(const Position& pos, const PsqtUpdates& updates) {
-        Color reload_side;
-        if (pos.king_side(Color::White) != m_king_sides[static_cast<usize>(Color::White)]) {
-            reload_side = Color::White;
-        } else if (pos.king_side(Color::Black) != m_king_sides[static_cast<usize>(Color::Black)]) {
-            reload_side = Color::Black;
-        } else {
-            for (const auto& add : updates.adds) {
-                add_piece(add.color, add.pt, add.sq);
+    // Records the updates of the move that led to `pos`, on a state copied from the parent.
+    // The accumulators are only brought up to date by `materialize`, when a score is needed.
+    void defer_updates(const Position& pos, const PsqtUpdates& updates) {
+        m_updates = updates;
+        for (Color c : {Color::White, Color::Black}) {
+            const usize ci        = static_cast<usize>(c);
+            const bool  king_side = pos.king_side(c);
+
+            m_needs_refresh[ci] = king_side != m_king_sides[ci];
+            m_king_sides[ci]    = king_side;
+            m_computed[ci]      = false;
+        }
+    }
+
+    // Brings the top of the stack up to date, walking back to the last computed ancestor of each
+    // color. If a king changed sides on the way, that color is rebuilt from `pos` instead.
+    // Returns the number of per-color accumulator updates performed.
+    static usize
+    materialize(std::span<PsqtState> stack, const Position& pos, PsqtRefreshCache& cache) {
+        usize      applied = 0;
+        PsqtState& top     = stack.back();
+
+        for (Color c : {Color::White, Color::Black}) {
+            const usize ci = static_cast<usize>(c);
+            if (top.m_computed[ci]) {
+                continue;
             }
 
-            for (const auto& remove : updates.removes) {
-                remove_piece(remove.color, remove.pt, remove.sq);
+            usize i = stack.size() - 1;
+            while (!stack[i].m_computed[ci] && !stack[i].m_needs_refresh[ci]) {
+                i--;
             }
-            return;
-        }
 
-        m_king_sides[static_cast<usize>(reload_side)] = pos.king_side(reload_side);
-        reload_accumulator(pos, reload_side);
+            if (!stack[i].m_computed[ci]) {
+                top.refresh_accumulator(pos, c, cache);
+                top.m_computed[ci] = true;
+                applied++;
+                continue;
+            }
 
-        for (const auto& remove : updates.removes) {
-            if (remove.color != reload_side) {
-                remove_piece(remove.color, remove.pt, remove.sq);
+            for (usize j = i + 1; j < stack.size(); j++) {
+                stack[j].m_accumulators[ci] = stack[j - 1].m_accumulators[ci];
+                stack[j].apply_deferred(c);
+                stack[j].m_computed[ci] = true;
+                applied++;
             }
         }
+
+        return applied;
     }
 
     PScore score() const {
+        assert(m_computed[0] && m_computed[1]);
         return m_accumulators[static_cast<usize>(Color::White)]
              - m_accumulators[static_cast<usize>(Color::Black)];
     }
@@ -77,90 +122,83 @@ public:
     bool operator!=(const PsqtState& other) const noexcept = default;
 
 private:
-    void reload_accumulator(const Position& pos, Color c) {
-        m_accumulators[static_cast<usize>(c)] = PSCORE_ZERO;
-        auto&     pieces                      = pos.piece_list(c);
-        auto&     squares                     = pos.piece_list_sq(c);
-        PieceMask valid_pieces                = pieces.mask_valid();
-
-        for (PieceId id : valid_pieces) {
-            PieceType pt = pieces[id];
-            add_piece(c, pt, squares[id]);
+    void apply_deferred(Color c) {
+        for (const auto& add : m_updates.adds) {
+            if (add.color == c) {
+                add_piece(add.color, add.pt, add.sq);
+            }
         }
-    }
 
-    void add_piece(Color color, PieceType pt, Square sq) {
-        if (color == Color::White) {
-            sq = sq.flip_vertical();
+        for (const auto& remove : m_updates.removes) {
+            if (remove.color == c) {
+                remove_piece(remove.color, remove.pt, remove.sq);
+            }
         }
+    }
 
-        if (m_king_sides[static_cast<usize>(color)]) {
-            sq = sq.flip_horizontal();
-        }
+    void refresh_accumulator(const Position& pos, Color c, PsqtRefreshCache& cache) {
+        const usize ci    = static_cast<usize>(c);
+        auto&       entry = cache.entry(c, m_king_sides[ci]);
 
-        auto& accumulator = m_accumulators[static_cast<usize>(color)];
-        switch (pt) {
-        case PieceType::Pawn:
-            accumulator += PAWN_MAT + PAWN_PSQT[sq.raw - 8];
-            break;
-        case PieceType::Knight:
-            accumulator += KNIGHT_MAT + KNIGHT_PSQT[sq.raw];
-            break;
-        case PieceType::Bishop:
-            accumulator += BISHOP_MAT + BISHOP_PSQT[sq.raw];
-            break;
-        case PieceType::Rook:
-            accumulator += ROOK_MAT + ROOK_PSQT[sq.raw];
-            break;
-        case PieceType::Queen:
-            accumulator += QUEEN_MAT + QUEEN_PSQT[sq.raw];
-            break;
-        case PieceType::King:
-            accumulator += KING_PSQT[sq.raw];
-            break;
-        default:
-            unreachable();
-            break;
+        for (PieceType pt : {PieceType::Pawn, PieceType::Knight, PieceType::Bishop, PieceType::Rook,
+                             PieceType::Queen, PieceType::King}) {
+            Bitboard& cached  = entry.pieces[static_cast<usize>(pt) - 1];
+            Bitboard  current = pos.bitboard_for(c, pt);
+
+            for (Square sq : current & ~cached) {
+                entry.accumulator += psqt_value(c, pt, sq, m_king_sides[ci]);
+            }
+            for (Square sq : cached & ~current) {
+                entry.accumulator -= psqt_value(c, pt, sq, m_king_sides[ci]);
+            }
+            cached = current;
         }
+
+        m_accumulators[ci] = entry.accumulator;
     }
 
-    void remove_piece(Color color, PieceType pt, Square sq) {
+    static PScore psqt_value(Color color, PieceType pt, Square sq, bool king_side) {
         if (color == Color::White) {
             sq = sq.flip_vertical();
         }
 
-        if (m_king_sides[static_cast<usize>(color)]) {
+        if (king_side) {
             sq = sq.flip_horizontal();
         }
 
-        auto& accumulator = m_accumulators[static_cast<usize>(color)];
         switch (pt) {
         case PieceType::Pawn:
-            accumulator -= PAWN_MAT + PAWN_PSQT[sq.raw - 8];
-            break;
+            return PAWN_MAT + PAWN_PSQT[sq.raw - 8];
         case PieceType::Knight:
-            accumulator -= KNIGHT_MAT + KNIGHT_PSQT[sq.raw];
-            break;
+            return KNIGHT_MAT + KNIGHT_PSQT[sq.raw];
         case PieceType::Bishop:
-            accumulator -= BISHOP_MAT + BISHOP_PSQT[sq.raw];
-            break;
+            return BISHOP_MAT + BISHOP_PSQT[sq.raw];
         case PieceType::Rook:
-            accumulator -= ROOK_MAT + ROOK_PSQT[sq.raw];
-            break;
+            return ROOK_MAT + ROOK_PSQT[sq.raw];
         case PieceType::Queen:
-            accumulator -= QUEEN_MAT + QUEEN_PSQT[sq.raw];
-            break;
+            return QUEEN_MAT + QUEEN_PSQT[sq.raw];
         case PieceType::King:
-            accumulator -= KING_PSQT[sq.raw];
-            break;
+            return KING_PSQT[sq.raw];
         default:
             unreachable();
-            break;
         }
     }
 
+    void add_piece(Color color, PieceType pt, Square sq) {
+        m_accumulators[static_cast<usize>(color)] +=
+          psqt_value(color, pt, sq, m_king_sides[static_cast<usize>(color)]);
+    }
+
+    void remove_piece(Color color, PieceType pt, Square sq) {
+        m_accumulators[static_cast<usize>(color)] -=
+          psqt_value(color, pt, sq, m_king_sides[static_cast<usize>(color)]);
+    }
+
     std::array<PScore, 2> m_accumulators;
     std::array<bool, 2>   m_king_sides;
+    std::array<bool, 2>   m_computed;
+    std::array<bool, 2>   m_needs_refresh;
+    PsqtUpdates           m_updates;
 };
 
 }  // namespace Clockwork
@@ -6,6 +6,7 @@
 #include "history.hpp"
 #include "movegen.hpp"
 #include "movepick.hpp"
+#include "numa.hpp"
 #include "see.hpp"
 #include "tm.hpp"
 #include "tuned.hpp"
@@ -28,6 +29,11 @@ static Value mated_in(i32 ply) {
     return -VALUE_MATED + ply;
 }
 
+// Lazy evals are partial, so they are never stored as the TT static eval.
+static Value tt_eval(Value raw_eval, bool lazy) {
+    return lazy ? -VALUE_INF : raw_eval;
+}
+
 static i32 stat_bonus(Depth bonus_depth) {
     return std::min(tuned::stat_bonus_max, tuned::stat_bonus_quad * bonus_depth * bonus_depth
                                              + tuned::stat_bonus_lin * bonus_depth
@@ -47,11 +53,19 @@ std::ostream& operator<<(std::ostream& os, const PV& pv) {
     return os;
 }
 
-Searcher::Searcher() :
-    idle_barrier(std::make_unique<std::barrier<>>(1)),
-    started_barrier(std::make_unique<std::barrier<>>(1)) {
+// TODO: add eval rescaling here once we get one
+std::string uci_score(Value score) {
+    if (score < -VALUE_WIN && score > -VALUE_MATED) {
+        return "mate " + std::to_string(-(VALUE_MATED + score + 1) / 2);
+    }
+    if (score > VALUE_WIN && score < VALUE_MATED) {
+        return "mate " + std::to_string((VALUE_MATED + 1 - score) / 2);
+    }
+    return "cp " + std::to_string(score / 4);
 }
 
+Searcher::Searcher() = default;
+
 Searcher::~Searcher() {
     exit();
 }
@@ -75,9 +89,19 @@ void Searcher::launch_search(SearchSettings settings_) {
         for (auto& worker : m_workers) {
             worker->prepare();
         }
+        started_workers.store(0, std::memory_order_relaxed);
     }
-    idle_barrier->arrive_and_wait();
-    started_barrier->arrive_and_wait();
+    wake_workers();
+
+    const u32 thread_count = static_cast<u32>(m_workers.size());
+    spin_then_wait(started_workers, [thread_count](u32 started) {
+        return started == thread_count;
+    });
+}
+
+void Searcher::wake_workers() {
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
 }
 
 void Searcher::stop_searching() {
@@ -102,6 +126,14 @@ Value Searcher::wait_for_score() {
     return m_workers[0]->get_thread_data().root_score;
 }
 
+SearchResult Searcher::wait_for_result() {
+    if (m_workers.empty() || m_workers[0]->thread_type() != ThreadType::MAIN) {
+        throw std::logic_error("wait_for_result can only be called from the main thread");
+    }
+    std::unique_lock lock_guard{mutex};
+    return m_workers[0]->get_thread_data().root_result;
+}
+
 void Searcher::initialize(size_t thread_count) {
     if (m_workers.size() == thread_count) {
         return;
@@ -111,21 +143,57 @@ void Searcher::initialize(size_t thread_count) {
         for (auto& worker : m_workers) {
             worker->exit();
         }
-        idle_barrier->arrive_and_wait();
+        wake_workers();
         m_workers.clear();
     }
 
-    idle_barrier    = std::make_unique<std::barrier<>>(1 + thread_count);
-    started_barrier = std::make_unique<std::barrier<>>(1 + thread_count);
-
-    if (thread_count > 0) {
-        m_workers.push_back(make_unique_huge_page<Worker>(*this, ThreadType::MAIN));
-        for (size_t i = 1; i < thread_count; i++) {
-            m_workers.push_back(make_unique_huge_page<Worker>(*this, ThreadType::SECONDARY));
+    for (size_t i = 0; i < thread_count; i++) {
+        ThreadType           thread_type = i == 0 ? ThreadType::MAIN : ThreadType::SECONDARY;
+        std::optional<usize> cpu         = m_thread_binding.cpu_for_thread(i);
+        if (!Numa::enabled) {
+            m_workers.push_back(
+              make_unique_huge_page<Worker>(*this, thread_type, std::nullopt, cpu));
+            continue;
         }
+
+        // Construct the worker from its own node, so its tables are first touched there
+        std::optional<usize> node =
+          cpu ? Numa::node_of_cpu(*cpu) : Numa::node_for_thread(i, thread_count);
+        Numa::run_on_node(node.value_or(0), [&] {
+            m_workers.push_back(make_unique_huge_page<Worker>(*this, thread_type, node, cpu));
+        });
     }
 }
 
+void Searcher::recreate_workers() {
+    size_t thread_count = m_workers.size();
+    initialize(0);
+    initialize(thread_count);
+}
+
+void Searcher::set_numa_aware(bool numa_aware) {
+    if (Numa::enabled == numa_aware) {
+        return;
+    }
+    Numa::enabled = numa_aware;
+
+    recreate_workers();
+    if (numa_aware) {
+        tt.interleave();
+        eval_cache.interleave();
+    } else {
+        // Pages keep their interleaved placement once mbind has moved them, so the tables are
+        // allocated afresh. Like a Hash change, this clears them.
+        resize_tt(tt.size_bytes() / (1024 * 1024));
+        resize_eval_cache(eval_cache.size_bytes() / (1024 * 1024));
+    }
+}
+
+void Searcher::set_thread_binding(Numa::ThreadBinding thread_binding) {
+    m_thread_binding = std::move(thread_binding);
+    recreate_workers();
+}
+
 void Searcher::exit() {
     initialize(0);
 }
@@ -136,22 +204,45 @@ void Searcher::reset() {
         worker->reset_thread_data();
     }
     tt.clear(m_workers.size());
+    eval_cache.clear(m_workers.size());
+}
+
+std::vector<MemoryRegion> Searcher::worker_memory() const {
+    std::vector<MemoryRegion> regions;
+    for (const auto& worker : m_workers) {
+        regions.push_back({worker.get(), sizeof(Worker)});
+    }
+    return regions;
 }
 
 u64 Searcher::node_count() {
     u64 nodes = 0;
     for (auto& worker : m_workers) {
-        nodes += worker->search_nodes();
+        nodes += worker->published_search_nodes();
     }
     return nodes;
 }
 
-Worker::Worker(Searcher& searcher, ThreadType thread_type) :
+SearchStats Searcher::stats() {
+    SearchStats stats;
+    for (auto& worker : m_workers) {
+        stats += worker->stats();
+    }
+    return stats;
+}
+
+Worker::Worker(Searcher&            searcher,
+               ThreadType           thread_type,
+               std::optional<usize> numa_node,
+               std::optional<usize> cpu) :
     m_searcher(searcher),
-    m_thread_type(thread_type) {
-    m_stopped = false;
-    m_exiting = false;
-    m_thread  = std::thread(&Worker::thread_main, this);
+    m_thread_type(thread_type),
+    m_numa_node(numa_node),
+    m_cpu(cpu) {
+    m_stopped         = false;
+    m_exiting         = false;
+    m_seen_generation = searcher.generation.load(std::memory_order_relaxed);
+    m_thread          = std::thread(&Worker::thread_main, this);
 }
 
 Worker::~Worker() {
@@ -178,15 +269,24 @@ void Worker::exit() {
 }
 
 void Worker::thread_main() {
+    if (m_cpu) {
+        Numa::bind_current_thread_to_cpu(*m_cpu);
+    } else if (m_numa_node) {
+        Numa::bind_current_thread(*m_numa_node);
+    }
+
     while (true) {
-        m_searcher.idle_barrier->arrive_and_wait();
+        m_seen_generation = spin_then_wait(m_searcher.generation, [this](u32 generation) {
+            return generation != m_seen_generation;
+        });
 
         if (m_exiting) {
             return;
         }
         {
             std::shared_lock lock_guard{m_searcher.mutex};
-            (void)m_searcher.started_barrier->arrive();
+            m_searcher.started_workers.fetch_add(1, std::memory_order_release);
+            m_searcher.started_workers.notify_one();
 
             start_searching();
         }
@@ -194,14 +294,24 @@ void Worker::thread_main() {
 }
 
 void Worker::prepare() {
-    m_stopped      = false;
-    m_search_nodes = 0;
+    m_stopped = false;
+    m_stats   = {};
+
+    m_search_nodes.reset();
+
+    m_td.pawn_table.hits   = 0;
+    m_td.pawn_table.misses = 0;
+    m_td.psqt_deferred     = 0;
+    m_td.psqt_applied      = 0;
 }
 
 void Worker::start_searching() {
     m_td.psqt_states.reserve(MAX_PLY + 1);
     m_td.psqt_states.clear();
     m_td.psqt_states.emplace_back(root_position);
+    m_td.attack_summaries.reserve(MAX_PLY + 1);
+    m_td.attack_summaries.clear();
+    m_td.attack_summaries.emplace_back();
 
     // Run iterative deepening search
     if (m_thread_type == ThreadType::MAIN) {
@@ -229,6 +339,9 @@ void Worker::start_searching() {
     } else {
         iterative_deepening<false>(root_position);
     }
+
+    // Make the final count exact for node_count() once the search is over
+    m_search_nodes.publish();
 }
 
 template<bool IS_MAIN>
@@ -244,22 +357,11 @@ Move Worker::iterative_deepening(const Position& root_position) {
     PV    last_pv{};
 
     const auto print_info_line = [&] {
-        // Lambda to convert internal units score to uci score. TODO: add eval rescaling here once we get one
-        auto format_score = [](Value score) {
-            if (score < -VALUE_WIN && score > -VALUE_MATED) {
-                return "mate " + std::to_string(-(VALUE_MATED + score + 1) / 2);
-            }
-            if (score > VALUE_WIN && score < VALUE_MATED) {
-                return "mate " + std::to_string((VALUE_MATED + 1 - score) / 2);
-            }
-            return "cp " + std::to_string(score / 4);
-        };
-
         // Get current time
         auto curr_time = time::Clock::now();
 
         std::cout << std::dec << "info depth " << last_search_depth << " seldepth " << last_seldepth
-                  << " score " << format_score(last_search_score) << " nodes "
+                  << " score " << uci_score(last_search_score) << " nodes "
                   << m_searcher.node_count() << " nps "
                   << time::nps(m_searcher.node_count(), curr_time - m_search_start);
         if (last_search_depth >= 16) {
@@ -270,6 +372,9 @@ Move Worker::iterative_deepening(const Position& root_position) {
     };
 
     m_node_counts.fill(0);
+    if constexpr (IS_MAIN) {
+        m_td.root_result = {};
+    }
 
     for (Depth search_depth = 1; search_depth < MAX_PLY; search_depth++) {
         // Call search
@@ -325,6 +430,14 @@ Move Worker::iterative_deepening(const Position& root_position) {
         base_search_score = search_depth == 1 ? score : base_search_score;
 
         m_td.root_score = last_search_score;
+        if constexpr (IS_MAIN) {
+            m_td.root_result = {.best_move = last_best_move,
+                                .score     = last_search_score,
+                                .depth     = last_search_depth,
+                                .seldepth  = last_seldepth,
+                                .pv        = last_pv};
+        }
+        m_search_nodes.publish();
 
         // Check depth limit
         if (IS_MAIN && search_depth >= m_search_limits.depth_limit) {
@@ -443,7 +556,7 @@ Value Worker::search(
         return evaluate(pos);
     }
 
-    auto tt_data = excluded ? std::nullopt : m_searcher.tt.probe(pos, ply);
+    auto tt_data = excluded ? std::nullopt : probe_tt(pos, ply);
     bool ttpv    = PV_NODE;
 
     if (!PV_NODE && tt_data) {
@@ -460,18 +573,26 @@ Value Worker::search(
 
     bool  is_in_check = pos.is_in_check();
     bool  improving   = false;
+    bool  lazy_eval   = false;
     Value correction  = 0;
     Value raw_eval    = -VALUE_INF;
     ss->static_eval   = -VALUE_INF;
     if (!is_in_check) {
-        correction      = excluded ? 0 : m_td.history.get_correction(pos);
-        raw_eval        = tt_data && !is_mate_score(tt_data->eval) ? tt_data->eval : evaluate(pos);
+        correction = excluded ? 0 : m_td.history.get_correction(pos);
+        if (tt_data && !is_mate_score(tt_data->eval)) {
+            raw_eval = tt_data->eval;
+        } else if (PV_NODE || !m_searcher.lazy_eval()) {
+            raw_eval = evaluate(pos);
+        } else {
+            raw_eval = evaluate(pos, alpha, beta, lazy_eval);
+        }
         ss->static_eval = adj_shuffle(pos, raw_eval) + correction;
         improving =
           is_valid_score((ss - 2)->static_eval) && ss->static_eval > (ss - 2)->static_eval;
 
         if (!tt_data) {
-            m_searcher.tt.store(pos, ply, raw_eval, Move::none(), -VALUE_INF, 0, ttpv, Bound::None);
+            m_searcher.tt.store(pos, ply, tt_eval(raw_eval, lazy_eval), Move::none(), -VALUE_INF,
+                                0, ttpv, Bound::None);
         }
     }
 
@@ -555,8 +676,8 @@ Value Worker::search(
         const Depth probcut_depth = std::clamp<Depth>(depth - 4, 1, depth - 1);
 
         if (!tt_data || tt_data->depth + 3 < depth || tt_data->score >= probcut_beta) {
-            MovePicker moves{pos, m_td.history, tt_data ? tt_data->move : Move::none(),
-                             tuned::probcut_see};
+            MovePicker moves{pos, m_td.history, m_td.attack_cache(),
+                             tt_data ? tt_data->move : Move::none(), tuned::probcut_see};
 
             for (Move m = moves.next(); m != Move::none(); m = moves.next()) {
 
@@ -578,15 +699,16 @@ Value Worker::search(
                 ss->cont_hist_entry = nullptr;
 
                 if (probcut_value >= probcut_beta) {
-                    m_searcher.tt.store(pos, ply, raw_eval, m, probcut_value, probcut_depth, false,
-                                        Bound::Lower);
+                    m_searcher.tt.store(pos, ply, tt_eval(raw_eval, lazy_eval), m, probcut_value,
+                                        probcut_depth, false, Bound::Lower);
                     return probcut_value;
                 }
             }
         }
     }
 
-    MovePicker moves{pos, m_td.history, tt_data ? tt_data->move : Move::none(), ply, ss};
+    MovePicker moves{pos, m_td.history, m_td.attack_cache(), tt_data ? tt_data->move : Move::none(),
+                     ply, ss};
     Move       best_move    = Move::none();
     Value      best_value   = -VALUE_INF;
     i32        moves_played = 0;
@@ -600,16 +722,20 @@ Value Worker::search(
     // Clear child's fail high count
     (ss + 1)->fail_high_count = 0;
 
+    // Squares the opponent attacks, for quiet move history
+    const Bitboard threats =
+      m_td.attack_cache().get(pos).any[static_cast<usize>(~pos.active_color())];
+
     // Iterate over the move list
     for (Move m = moves.next(); m != Move::none(); m = moves.next()) {
         if (m == ss->excluded_move) {
             continue;
         }
 
-        const auto nodes_before = m_search_nodes.load(std::memory_order::relaxed);
+        const auto nodes_before = search_nodes();
         bool       quiet        = quiet_move(m);
 
-        auto move_history = quiet ? m_td.history.get_quiet_stats(pos, m, ply, ss) : 0;
+        auto move_history = quiet ? m_td.history.get_quiet_stats(pos, threats, m, ply, ss) : 0;
 
         if (!ROOT_NODE && !is_being_mated_score(best_value)) {
             // Late Move Pruning (LMP)
@@ -634,7 +760,8 @@ Value Worker::search(
             Value see_threshold =
               quiet ? tuned::see_pvs_quiet * depth : tuned::see_pvs_noisy_quad * depth * depth;
             // SEE PVS Pruning
-            if (!SEE::see(pos, m, see_threshold - move_history * tuned::see_pvs_hist_mult / 1024)) {
+            if (!SEE::see(pos, m, see_threshold - move_history * tuned::see_pvs_hist_mult / 1024,
+                          m_td.attack_cache().get(pos))) {
                 continue;
             }
         }
@@ -813,7 +940,7 @@ Value Worker::search(
             value =
               -search<IS_MAIN, true>(pos_after, ss + 1, -beta, -alpha, new_depth, ply + 1, false);
         }
-        const auto nodes_after = m_search_nodes.load(std::memory_order::relaxed);
+        const auto nodes_after = search_nodes();
         if (ROOT_NODE) {
             m_node_counts[m.from_to()] += nodes_after - nodes_before;
         }
@@ -861,9 +988,9 @@ Value Worker::search(
         if (quiet_move(best_move)) {
             ss->killer = best_move;
 
-            m_td.history.update_quiet_stats(pos, best_move, ply, ss, bonus);
+            m_td.history.update_quiet_stats(pos, threats, best_move, ply, ss, bonus);
             for (Move quiet : quiets_played) {
-                m_td.history.update_quiet_stats(pos, quiet, ply, ss, -malus);
+                m_td.history.update_quiet_stats(pos, threats, quiet, ply, ss, -malus);
             }
         } else {
             m_td.history.update_noisy_stats(pos, best_move, bonus);
@@ -893,10 +1020,11 @@ Value Worker::search(
         Move  tt_move = best_move != Move::none() ? best_move
                       : tt_data                   ? tt_data->move
                                                   : Move::none();
-        m_searcher.tt.store(pos, ply, raw_eval, tt_move, best_value, depth, ttpv, bound);
+        m_searcher.tt.store(pos, ply, tt_eval(raw_eval, lazy_eval), tt_move, best_value, depth,
+                            ttpv, bound);
 
         // Update to correction history.
-        if (!is_in_check
+        if (!is_in_check && !lazy_eval
             && !(best_move != Move::none() && (best_move.is_capture() || best_move.is_promotion()))
             && !((bound == Bound::Lower && best_value <= ss->static_eval)
                  || (bound == Bound::Upper && best_value >= ss->static_eval))) {
@@ -953,7 +1081,7 @@ Value Worker::quiesce(const Position& pos, Stack* ss, Value alpha, Value beta, i
     }
 
     // TT Probing
-    auto tt_data = m_searcher.tt.probe(pos, ply);
+    auto tt_data = probe_tt(pos, ply);
     if (!PV_NODE && tt_data
         && (tt_data->bound() == Bound::Exact
             || (tt_data->bound() == Bound::Lower && tt_data->score >= beta)
@@ -963,16 +1091,24 @@ Value Worker::quiesce(const Position& pos, Stack* ss, Value alpha, Value beta, i
 
     bool  is_in_check = pos.is_in_check();
     bool  ttpv        = PV_NODE || (tt_data && tt_data->ttpv());
+    bool  lazy_eval   = false;
     Value correction  = 0;
     Value raw_eval    = -VALUE_INF;
     Value static_eval = -VALUE_INF;
     if (!is_in_check) {
-        correction  = m_td.history.get_correction(pos);
-        raw_eval    = tt_data && !is_mate_score(tt_data->eval) ? tt_data->eval : evaluate(pos);
+        correction = m_td.history.get_correction(pos);
+        if (tt_data && !is_mate_score(tt_data->eval)) {
+            raw_eval = tt_data->eval;
+        } else if (PV_NODE || !m_searcher.lazy_eval()) {
+            raw_eval = evaluate(pos);
+        } else {
+            raw_eval = evaluate(pos, alpha, beta, lazy_eval);
+        }
         static_eval = adj_shuffle(pos, raw_eval) + correction;
 
         if (!tt_data) {
-            m_searcher.tt.store(pos, ply, raw_eval, Move::none(), -VALUE_INF, 0, ttpv, Bound::None);
+            m_searcher.tt.store(pos, ply, tt_eval(raw_eval, lazy_eval), Move::none(), -VALUE_INF,
+                                0, ttpv, Bound::None);
         }
     }
 
@@ -982,7 +1118,7 @@ Value Worker::quiesce(const Position& pos, Stack* ss, Value alpha, Value beta, i
     }
     alpha = std::max(alpha, static_eval);
 
-    MovePicker moves{pos, m_td.history, Move::none(), ply, ss};
+    MovePicker moves{pos, m_td.history, m_td.attack_cache(), Move::none(), ply, ss};
     if (!is_in_check) {
         moves.skip_quiets();
     }
@@ -999,7 +1135,8 @@ Value Worker::quiesce(const Position& pos, Stack* ss, Value alpha, Value beta, i
         }
 
         // QS SEE Pruning
-        if (!is_being_mated_score(best_value) && !SEE::see(pos, m, tuned::quiesce_see_threshold)) {
+        if (!is_being_mated_score(best_value)
+            && !SEE::see(pos, m, tuned::quiesce_see_threshold, m_td.attack_cache().get(pos))) {
             continue;
         }
 
@@ -1048,16 +1185,54 @@ Value Worker::quiesce(const Position& pos, Stack* ss, Value alpha, Value beta, i
     // Store to the TT
     Bound bound   = best_value >= beta ? Bound::Lower : Bound::Upper;
     Move  tt_move = best_move != Move::none() ? best_move : tt_data ? tt_data->move : Move::none();
-    m_searcher.tt.store(pos, ply, raw_eval, tt_move, best_value, 0, ttpv, bound);
+    m_searcher.tt.store(pos, ply, tt_eval(raw_eval, lazy_eval), tt_move, best_value, 0, ttpv,
+                        bound);
 
     return best_value;
 }
 
+std::optional<TTData> Worker::probe_tt(const Position& pos, i32 ply) {
+    auto tt_data = m_searcher.tt.probe(pos, ply);
+    if (tt_data) {
+        m_stats.tt_hits++;
+    } else {
+        m_stats.tt_misses++;
+    }
+    return tt_data;
+}
+
 Value Worker::evaluate(const Position& pos) {
+    bool lazy = false;
+    return evaluate(pos, -VALUE_INF, VALUE_INF, lazy);
+}
+
+Value Worker::evaluate([[maybe_unused]] const Position& pos,
+                       [[maybe_unused]] Value           alpha,
+                       [[maybe_unused]] Value           beta,
+                       [[maybe_unused]] bool&           lazy) {
 #ifndef EVAL_TUNING
-    return std::clamp<Value>(
-      static_cast<Value>(Clockwork::evaluate_stm_pov(pos, m_td.psqt_states.back())), -VALUE_WIN + 1,
-      VALUE_WIN - 1);
+    if (auto cached = m_searcher.eval_cache.probe(pos.get_hash_key())) {
+        m_stats.eval_cache_hits++;
+        return *cached;
+    }
+    m_stats.eval_cache_misses++;
+
+    const PsqtState& psqt_state = m_td.materialize_psqt_state(pos);
+    const LazyWindow window{alpha, beta, tuned::lazy_eval_margin};
+
+    Value eval = std::clamp<Value>(
+      static_cast<Value>(Clockwork::evaluate_stm_pov(pos, psqt_state, m_td.pawn_table,
+                                                     m_td.material_table, m_td.attack_cache(),
+                                                     window, lazy)),
+      -VALUE_WIN + 1, VALUE_WIN - 1);
+
+    // Partial evals must never be reused as a full static eval
+    if (lazy) {
+        m_stats.lazy_evals++;
+    } else {
+        m_searcher.eval_cache.store(pos.get_hash_key(), eval);
+    }
+    return eval;
 #else
     return -VALUE_INF;  // Not implemented in tune mode
 #endif
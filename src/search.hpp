@@ -1,16 +1,22 @@
 #pragma once
 
+#include "eval_cache.hpp"
 #include "history.hpp"
+#include "material_table.hpp"
 #include "move.hpp"
+#include "numa.hpp"
+#include "pawn_table.hpp"
 #include "position.hpp"
 #include "psqt_state.hpp"
 #include "repetition_info.hpp"
 #include "tt.hpp"
+#include "util/node_counter.hpp"
+#include "util/spin_wait.hpp"
 #include "util/static_vector.hpp"
 #include "util/types.hpp"
-#include <barrier>
 #include <iosfwd>
 #include <memory>
+#include <optional>
 #include <shared_mutex>
 #include <thread>
 
@@ -61,6 +67,18 @@ private:
     StaticVector<Move, MAX_PLY + 1> m_pv;
 };
 
+// The last completed iteration of the main thread.
+struct SearchResult {
+    Move  best_move = Move::none();
+    Value score     = 0;
+    Depth depth     = 0;
+    Depth seldepth  = 0;
+    PV    pv;
+};
+
+// Formats a score the way UCI expects it, e.g. "cp 25" or "mate -3".
+std::string uci_score(Value score);
+
 struct Stack {
     Value          static_eval = 0;
     Move           killer      = Move::none();
@@ -78,18 +96,67 @@ struct SearchLimits {
     Depth           depth_limit;
 };
 
+struct SearchStats {
+    u64 eval_cache_hits   = 0;
+    u64 eval_cache_misses = 0;
+    u64 pawn_table_hits   = 0;
+    u64 pawn_table_misses = 0;
+    u64 psqt_deferred     = 0;
+    u64 psqt_applied      = 0;
+    u64 lazy_evals        = 0;
+    u64 tt_hits           = 0;
+    u64 tt_misses         = 0;
+
+    SearchStats& operator+=(const SearchStats& other) {
+        eval_cache_hits += other.eval_cache_hits;
+        eval_cache_misses += other.eval_cache_misses;
+        pawn_table_hits += other.pawn_table_hits;
+        pawn_table_misses += other.pawn_table_misses;
+        psqt_deferred += other.psqt_deferred;
+        psqt_applied += other.psqt_applied;
+        lazy_evals += other.lazy_evals;
+        tt_hits += other.tt_hits;
+        tt_misses += other.tt_misses;
+        return *this;
+    }
+};
+
 struct ThreadData {
     History                history;
+    PawnTable              pawn_table;
+    MaterialTable          material_table;
     std::vector<PsqtState> psqt_states;
+    PsqtRefreshCache       psqt_refresh_cache;
+
+    // One attack summary per node on the psqt stack. Moves push an empty one, null moves share
+    // the parent's as they do not change the attack tables.
+    std::vector<AttackSummaryCache> attack_summaries;
     Value                  root_score;
+    SearchResult           root_result;
+
+    // Per-color accumulator updates deferred by moves, and those actually performed.
+    u64 psqt_deferred = 0;
+    u64 psqt_applied  = 0;
 
     PsqtState& push_psqt_state() {
         psqt_states.push_back(psqt_states.back());
+        attack_summaries.emplace_back();
+        psqt_deferred += 2;
         return psqt_states.back();
     }
 
     void pop_psqt_state() {
         psqt_states.pop_back();
+        attack_summaries.pop_back();
+    }
+
+    AttackSummaryCache& attack_cache() {
+        return attack_summaries.back();
+    }
+
+    const PsqtState& materialize_psqt_state(const Position& pos) {
+        psqt_applied += PsqtState::materialize(psqt_states, pos, psqt_refresh_cache);
+        return psqt_states.back();
     }
 };
 
@@ -98,6 +165,7 @@ public:
     SearchLimits   search_limits;
     SearchSettings settings;
     TT             tt;
+    EvalCache      eval_cache;
 
     // We use a shared_mutex to ensure proper mutual thread exclusion.and avoid races.
     // The UCI thread only ever obtains exclusive access (using std::unique_lock);
@@ -105,9 +173,10 @@ public:
     // This ensures that the two classes of thread never step on each other.
     std::shared_mutex mutex;
 
-    using BarrierPtr = std::unique_ptr<std::barrier<>>;
-    BarrierPtr idle_barrier;
-    BarrierPtr started_barrier;
+    // Idle workers wait for the generation to change (spinning briefly, then on a futex).
+    // Once a worker holds its shared lock it reports in through started_workers.
+    std::atomic<u32> generation{0};
+    std::atomic<u32> started_workers{0};
 
     Searcher();
     ~Searcher();
@@ -116,17 +185,44 @@ public:
     void  stop_searching();
     void  wait();
     Value wait_for_score();
+    // Waits for the search to finish, like wait_for_score.
+    SearchResult wait_for_result();
     void  initialize(size_t thread_count);
+    void  set_numa_aware(bool numa_aware);
+    void  set_thread_binding(Numa::ThreadBinding thread_binding);
     void  exit();
 
-    u64  node_count();
-    void reset();
-    void resize_tt(size_t mb) {
+    [[nodiscard]] const Numa::ThreadBinding& thread_binding() const {
+        return m_thread_binding;
+    }
+
+    // Lazy eval lets non-PV nodes stop at the cheap eval terms when they are far outside the
+    // window. It is off until it has passed a strength test, and only changes between searches.
+    void set_lazy_eval(bool lazy_eval) {
+        m_lazy_eval = lazy_eval;
+    }
+    [[nodiscard]] bool lazy_eval() const {
+        return m_lazy_eval;
+    }
+    [[nodiscard]] std::vector<MemoryRegion> worker_memory() const;
+
+    u64         node_count();
+    SearchStats stats();
+    void        reset();
+    void        resize_tt(size_t mb) {
         tt.resize(mb, m_workers.size());
     }
+    void resize_eval_cache(size_t mb) {
+        eval_cache.resize(mb, m_workers.size());
+    }
 
 private:
     std::vector<unique_ptr_huge_page<Worker>> m_workers;
+    Numa::ThreadBinding                       m_thread_binding;
+    bool                                      m_lazy_eval = false;
+
+    void recreate_workers();
+    void wake_workers();
 };
 
 class alignas(128) Worker {
@@ -134,7 +230,10 @@ public:
     Position       root_position;
     RepetitionInfo repetition_info;
 
-    Worker(Searcher& searcher, ThreadType thread_type);
+    Worker(Searcher&            searcher,
+           ThreadType           thread_type,
+           std::optional<usize> numa_node,
+           std::optional<usize> cpu);
     ~Worker();
 
     void exit();
@@ -152,14 +251,29 @@ public:
     [[nodiscard]] ThreadType thread_type() const {
         return m_thread_type;
     }
+    // Exact node count, only to be used by the worker itself.
     [[nodiscard]] u64 search_nodes() const {
-        return m_search_nodes.load(std::memory_order_relaxed);
+        return m_search_nodes.local();
+    }
+    // Node count as seen from other threads.
+    [[nodiscard]] u64 published_search_nodes() const {
+        return m_search_nodes.published();
     }
 
     [[nodiscard]] const ThreadData& get_thread_data() const {
         return m_td;
     }
 
+    // Only meaningful once the search has finished.
+    [[nodiscard]] SearchStats stats() const {
+        SearchStats stats       = m_stats;
+        stats.pawn_table_hits   = m_td.pawn_table.hits;
+        stats.pawn_table_misses = m_td.pawn_table.misses;
+        stats.psqt_deferred     = m_td.psqt_deferred;
+        stats.psqt_applied      = m_td.psqt_applied;
+        return stats;
+    }
+
     [[nodiscard]] Value get_draw_score() const {
         return (search_nodes() & 3) - 2;  // Randomize between -2 and +2
     }
@@ -168,19 +282,23 @@ private:
     void thread_main();
 
     void increment_search_nodes() {
-        m_search_nodes.fetch_add(1, std::memory_order_relaxed);
+        m_search_nodes.increment();
     }
 
-    std::atomic<u64>         m_search_nodes;
+    NodeCounter              m_search_nodes;
     time::TimePoint          m_search_start;
     time::TimePoint          m_last_info_time;
     Searcher&                m_searcher;
     std::thread              m_thread;
     ThreadType               m_thread_type;
+    std::optional<usize>     m_numa_node;
+    std::optional<usize>     m_cpu;
     SearchLimits             m_search_limits;
     ThreadData               m_td;
+    SearchStats              m_stats;
     std::atomic<bool>        m_stopped;
     std::atomic<bool>        m_exiting;
+    u32                      m_seen_generation;
     std::array<u64, 64 * 64> m_node_counts;
     Depth                    m_seldepth;
     bool                     m_in_nmp_verification = false;
@@ -193,8 +311,12 @@ private:
     template<bool IS_MAIN, bool PV_NODE>
     Value quiesce(const Position& pos, Stack* ss, Value alpha, Value beta, i32 ply);
     Value evaluate(const Position& pos);
+    // May return a partial eval far outside of [alpha, beta], in which case `lazy` is set.
+    Value evaluate(const Position& pos, Value alpha, Value beta, bool& lazy);
     Value adj_shuffle(const Position& pos, Value value);
     bool  check_tm_hard_limit();
+
+    std::optional<TTData> probe_tt(const Position& pos, i32 ply);
 };
 
 }  // namespace Search
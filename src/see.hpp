@@ -128,4 +128,15 @@ inline bool see(const Position& pos, Move move, Value threshold) {
     return stm != pos.active_color();
 }
 
+// Same as above, but skips the exchange when the opponent can neither recapture on the target
+// square nor x-ray through the square the piece leaves. The move then wins exactly its gain.
+inline bool see(const Position& pos, Move move, Value threshold, const AttackSummary& attacks) {
+    const Bitboard theirs = attacks.any[static_cast<usize>(invert(pos.active_color()))];
+    if (!move.is_castle() && !move.is_en_passant() && !theirs.is_set(move.to())
+        && !theirs.is_set(move.from())) {
+        return gain(pos, move) >= threshold;
+    }
+    return see(pos, move, threshold);
+}
+
 }  // namespace Clockwork::SEE
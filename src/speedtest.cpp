@@ -1,4 +1,5 @@
 #include "speedtest.hpp"
+#include "numa.hpp"
 #include "position.hpp"
 #include "repetition_info.hpp"
 #include "search.hpp"
@@ -335,7 +336,7 @@ const std::vector<std::string> SPEEDTEST_FENS = {
   "8/8/3k4/4R3/3K4/8/8/8 b - - 11 75",
 };
 
-void speedtest(Search::Searcher& searcher) {
+f64 run_speedtest(Search::Searcher& searcher) {
     u64  total_nodes = 0;
     auto start_time  = time::Clock::now();
 
@@ -399,6 +400,37 @@ void speedtest(Search::Searcher& searcher) {
     std::cout << "Total nodes: " << total_nodes << std::endl;
     std::cout << "Total time: " << duration_ms << " ms" << std::endl;
     std::cout << "Nodes per second: " << static_cast<u64>(nps) << std::endl;
+
+    return nps;
+}
+
+void speedtest(Search::Searcher& searcher) {
+    const Numa::ThreadBinding original = searcher.thread_binding();
+
+    std::vector<Numa::ThreadBinding> bindings = {
+      {Numa::ThreadBinding::Mode::None, {}},
+      {Numa::ThreadBinding::Mode::Compact, {}},
+      {Numa::ThreadBinding::Mode::Scatter, {}},
+    };
+    if (original.mode == Numa::ThreadBinding::Mode::List) {
+        bindings.push_back(original);
+    }
+
+    std::vector<f64> results;
+    for (const Numa::ThreadBinding& binding : bindings) {
+        std::cout << "Thread binding: " << binding.to_string() << std::endl;
+        searcher.set_thread_binding(binding);
+        searcher.reset();
+        results.push_back(run_speedtest(searcher));
+        std::cout << std::endl;
+    }
+
+    searcher.set_thread_binding(original);
+
+    for (usize i = 0; i < bindings.size(); i++) {
+        std::cout << "Nodes per second (" << bindings[i].to_string()
+                  << "): " << static_cast<u64>(results[i]) << std::endl;
+    }
 }
 
 }  // namespace Speedtest
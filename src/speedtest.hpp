@@ -1,10 +1,15 @@
 #pragma once
 
 #include "search.hpp"
+#include "util/types.hpp"
 
 namespace Clockwork {
 namespace Speedtest {
 
+// Runs the suite once with the searcher's current settings and returns the nodes per second.
+f64 run_speedtest(Search::Searcher& searcher);
+
+// Runs the suite once per thread binding mode and compares their speed.
 void speedtest(Search::Searcher& searcher);
 
 }  // namespace Speedtest
@@ -1,6 +1,17 @@
 #include "tt.hpp"
+#include "numa.hpp"
 #include <algorithm>  // For std::min
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <thread>
+#include <vector>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
 
 namespace Clockwork {
 
@@ -57,14 +68,16 @@ Value score_from_tt(i16 ttScore, i32 ply) {
     }
 }
 
-TT::TT(size_t mb) :
+template<usize ENTRIES>
+TranspositionTable<ENTRIES>::TranspositionTable(size_t mb) :
     m_clusters{nullptr},
     m_size{0},
     m_age{0} {
     resize(mb, 1);
 }
 
-std::optional<TTData> TT::probe(const Position& pos, i32 ply) const {
+template<usize ENTRIES>
+std::optional<TTData> TranspositionTable<ENTRIES>::probe(const Position& pos, i32 ply) const {
     size_t     idx     = mulhi64(pos.get_hash_key(), m_size);
     const auto cluster = this->m_clusters[idx].load();
     const auto key     = shrink_key(pos.get_hash_key());
@@ -86,19 +99,35 @@ std::optional<TTData> TT::probe(const Position& pos, i32 ply) const {
     return {};
 }
 
-TTClusterMemory* TT::addr_key(const u64 key) const {
+template<usize ENTRIES>
+auto TranspositionTable<ENTRIES>::addr_key(const u64 key) const -> ClusterMemory* {
     size_t idx = mulhi64(key, m_size);
     return &this->m_clusters[idx];
 }
 
-void TT::store(const Position& pos,
-               i32             ply,
-               Value           eval,
-               Move            move,
-               Value           score,
-               Depth           depth,
-               bool            ttpv,
-               Bound           bound) {
+// Lower scores are replaced first. With only three entries to a bucket, recent shallow entries
+// should still give way to much deeper old ones. Larger buckets can afford to hold on to the
+// current search's entries and clear out stale ones first, keeping PV nodes a little longer.
+template<usize ENTRIES>
+i32 TranspositionTable<ENTRIES>::replacement_score(const TTEntry& entry) const {
+    i32 relative_age = (MAX_AGE + m_age - entry.age()) & AGE_MASK;
+    if constexpr (ENTRIES <= 3) {
+        return entry.depth - relative_age * 4;
+    } else {
+        return entry.depth - relative_age * 8 + (entry.ttpv() ? 2 : 0)
+             + (entry.bound() == Bound::Exact ? 1 : 0);
+    }
+}
+
+template<usize ENTRIES>
+void TranspositionTable<ENTRIES>::store(const Position& pos,
+                                        i32             ply,
+                                        Value           eval,
+                                        Move            move,
+                                        Value           score,
+                                        Depth           depth,
+                                        bool            ttpv,
+                                        Bound           bound) {
     size_t     cluster_index = mulhi64(pos.get_hash_key(), m_size);
     auto       cluster       = this->m_clusters[cluster_index].load();
     const auto key           = shrink_key(pos.get_hash_key());
@@ -107,7 +136,7 @@ void TT::store(const Position& pos,
     size_t idx = 0;
 
     if (!(tte.key16 == 0 || tte.key16 == key)) {
-        for (size_t i = 1; i < 3; ++i) {
+        for (size_t i = 1; i < ENTRIES; ++i) {
             const auto entry = cluster.entries[i];
 
             if (entry.key16 == 0 || entry.key16 == key) {
@@ -116,8 +145,7 @@ void TT::store(const Position& pos,
                 break;
             }
 
-            if (tte.depth - ((MAX_AGE + m_age - tte.age()) & AGE_MASK) * 4
-                > entry.depth - ((MAX_AGE + m_age - entry.age()) & AGE_MASK) * 4) {
+            if (replacement_score(tte) > replacement_score(entry)) {
                 tte = entry;
                 idx = i;
             }
@@ -162,17 +190,27 @@ void TT::store(const Position& pos,
     }
 }
 
-void TT::resize(size_t mb, usize thread_count) {
+template<usize ENTRIES>
+void TranspositionTable<ENTRIES>::resize(size_t mb, usize thread_count) {
 
     size_t bytes   = mb * 1024 * 1024;
-    size_t entries = bytes / sizeof(TTClusterMemory);
+    size_t entries = bytes / sizeof(ClusterMemory);
 
     m_size     = entries;
-    m_clusters = make_unique_for_overwrite_huge_page<TTClusterMemory[]>(m_size);
+    m_clusters = make_unique_for_overwrite_huge_page<ClusterMemory[]>(m_size);
+    interleave();
     clear(thread_count);
 }
 
-void TT::clear(usize thread_count) {
+template<usize ENTRIES>
+void TranspositionTable<ENTRIES>::interleave() {
+    if (Numa::enabled) {
+        Numa::interleave(m_clusters.get(), m_size * sizeof(ClusterMemory));
+    }
+}
+
+template<usize ENTRIES>
+void TranspositionTable<ENTRIES>::clear(usize thread_count) {
     std::vector<std::thread> threads;
     threads.reserve(thread_count);
     for (usize t = 0; t < thread_count; ++t) {
@@ -183,10 +221,9 @@ void TT::clear(usize thread_count) {
                 end = m_size;
             }
             for (size_t i = start; i < end; ++i) {
-                m_clusters[i].data[0].store(0, std::memory_order_relaxed);
-                m_clusters[i].data[1].store(0, std::memory_order_relaxed);
-                m_clusters[i].data[2].store(0, std::memory_order_relaxed);
-                m_clusters[i].data[3].store(0, std::memory_order_relaxed);
+                for (auto& word : m_clusters[i].data) {
+                    word.store(0, std::memory_order_relaxed);
+                }
             }
         });
     }
@@ -195,12 +232,14 @@ void TT::clear(usize thread_count) {
     }
 }
 
-void TT::increment_age() {
+template<usize ENTRIES>
+void TranspositionTable<ENTRIES>::increment_age() {
     const u8 new_age = (this->m_age + 1) & AGE_MASK;
     this->m_age      = new_age;
 }
 
-i32 TT::hashfull() const {
+template<usize ENTRIES>
+i32 TranspositionTable<ENTRIES>::hashfull() const {
     if (m_size == 0) {
         return 0;
     }
@@ -223,8 +262,247 @@ i32 TT::hashfull() const {
     }
 
     // Return permill (0-1000)
-    // Each cluster has 3 entries, so num_to_probe * 3 is the total number of entries sampled.
-    return static_cast<i32>((static_cast<u64>(occupied_count) * 1000) / (num_to_probe * 3));
+    // Each cluster has ENTRIES entries, so num_to_probe * ENTRIES entries were sampled.
+    return static_cast<i32>((static_cast<u64>(occupied_count) * 1000) / (num_to_probe * ENTRIES));
+}
+
+// savehash/loadhash file layout: this header followed by the raw clusters, in native byte order.
+// The header is padded to the cluster alignment so a mapped file can be used in place.
+struct TTFileHeader {
+    std::array<char, 8> magic;
+    u32                 version;
+    u32                 cluster_bytes;
+    u64                 cluster_count;
+    u64                 checksum;
+    u8                  age;
+    u8                  entries_per_cluster;  // Layouts with equal cluster sizes still differ
+    std::array<u8, 30>  reserved;
+};
+
+static_assert(sizeof(TTFileHeader) == TT::TT_ALIGNMENT);
+
+constexpr std::array<char, 8> TT_FILE_MAGIC     = {'C', 'W', 'T', 'T', 'H', 'A', 'S', 'H'};
+constexpr u32                 TT_FILE_VERSION   = 2;
+constexpr size_t              TT_FILE_CHUNK     = 1 << 15;        // Clusters per read or write
+constexpr u64                 TT_FILE_MAX_BYTES = u64{1} << 48;  // Far beyond any usable hash size
+
+template<usize ENTRIES>
+using ClusterWords = std::array<u64, TTClusterMemory<ENTRIES>::WORDS>;
+
+// Four independent multiply-xorshift lanes, so hashing keeps up with the disk.
+class TTChecksum {
+public:
+    template<usize N>
+    void update(const std::array<u64, N>& words) {
+        for (usize i = 0; i < N; i++) {
+            u64& lane = m_lanes[i % m_lanes.size()];
+            lane      = (lane ^ words[i]) * 0x9E3779B97F4A7C15;
+            lane ^= lane >> 32;
+        }
+    }
+
+    [[nodiscard]] u64 digest(u64 cluster_count) const {
+        u64 hash = cluster_count;
+        for (u64 lane : m_lanes) {
+            hash = (hash ^ lane) * 0xFF51AFD7ED558CCD;
+            hash ^= hash >> 33;
+        }
+        return hash;
+    }
+
+private:
+    std::array<u64, 4> m_lanes = {1, 2, 3, 4};
+};
+
+std::string_view to_string(TTFileStatus status) {
+    switch (status) {
+    case TTFileStatus::Ok:
+        return "ok";
+    case TTFileStatus::OpenFailed:
+        return "could not open file";
+    case TTFileStatus::IoError:
+        return "i/o error";
+    case TTFileStatus::BadHeader:
+        return "not a hash file or unsupported version";
+    case TTFileStatus::SizeMismatch:
+        return "file size does not match header";
+    case TTFileStatus::ChecksumMismatch:
+        return "checksum mismatch";
+    }
+    return "unknown error";
+}
+
+template<usize ENTRIES>
+TTFileStatus TranspositionTable<ENTRIES>::save(const std::string& path) const {
+    // Written under a temporary name and renamed into place. Truncating the file in place would
+    // pull the pages out from under a table mapped from it, which may well be this one.
+    std::string   temp_path = path + ".tmp";
+    std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+    if (!file) {
+        return TTFileStatus::OpenFailed;
+    }
+
+    TTFileHeader header{};
+    header.magic               = TT_FILE_MAGIC;
+    header.version             = TT_FILE_VERSION;
+    header.cluster_bytes       = sizeof(ClusterMemory);
+    header.cluster_count       = m_size;
+    header.age                 = m_age;
+    header.entries_per_cluster = static_cast<u8>(ENTRIES);
+
+    // The checksum is only known at the end, so the header is written again afterwards
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    TTChecksum                         checksum;
+    std::vector<ClusterWords<ENTRIES>> buffer;
+    buffer.reserve(TT_FILE_CHUNK);
+    for (size_t start = 0; start < m_size; start += TT_FILE_CHUNK) {
+        size_t end = std::min(m_size, start + TT_FILE_CHUNK);
+        buffer.clear();
+        for (size_t i = start; i < end; i++) {
+            auto words = std::bit_cast<ClusterWords<ENTRIES>>(m_clusters[i].load());
+            checksum.update(words);
+            buffer.push_back(words);
+        }
+        file.write(reinterpret_cast<const char*>(buffer.data()),
+                   static_cast<std::streamsize>(buffer.size() * sizeof(buffer[0])));
+    }
+
+    header.checksum = checksum.digest(m_size);
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+
+    std::error_code ec;
+    if (file) {
+        std::filesystem::rename(temp_path, path, ec);
+    }
+    if (!file || ec) {
+        std::filesystem::remove(temp_path, ec);
+        return TTFileStatus::IoError;
+    }
+    return TTFileStatus::Ok;
 }
 
+template<usize ENTRIES>
+static TTFileStatus read_clusters(std::ifstream&                                    file,
+                                  const TTFileHeader&                               header,
+                                  unique_ptr_huge_page<TTClusterMemory<ENTRIES>[]>& clusters) {
+    clusters =
+      make_unique_for_overwrite_huge_page<TTClusterMemory<ENTRIES>[]>(header.cluster_count);
+
+    TTChecksum                         checksum;
+    std::vector<ClusterWords<ENTRIES>> buffer(TT_FILE_CHUNK);
+    for (size_t start = 0; start < header.cluster_count; start += TT_FILE_CHUNK) {
+        size_t count = std::min<size_t>(header.cluster_count - start, TT_FILE_CHUNK);
+        if (!file.read(reinterpret_cast<char*>(buffer.data()),
+                       static_cast<std::streamsize>(count * sizeof(buffer[0])))) {
+            return TTFileStatus::IoError;
+        }
+        for (size_t i = 0; i < count; i++) {
+            checksum.update(buffer[i]);
+            for (usize w = 0; w < buffer[i].size(); w++) {
+                clusters[start + i].data[w].store(buffer[i][w], std::memory_order_relaxed);
+            }
+        }
+    }
+
+    return checksum.digest(header.cluster_count) == header.checksum
+           ? TTFileStatus::Ok
+           : TTFileStatus::ChecksumMismatch;
+}
+
+#ifdef __linux__
+// Maps the file copy-on-write and uses the clusters in place. Pages stay shared with the page
+// cache until the search writes to them.
+template<usize ENTRIES>
+static TTFileStatus map_clusters(const std::string&                                path,
+                                 size_t                                            file_size,
+                                 const TTFileHeader&                               header,
+                                 unique_ptr_huge_page<TTClusterMemory<ENTRIES>[]>& clusters) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return TTFileStatus::OpenFailed;
+    }
+    void* base = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return TTFileStatus::IoError;
+    }
+    madvise(base, file_size, MADV_WILLNEED);
+
+    const std::byte* data = static_cast<const std::byte*>(base) + sizeof(TTFileHeader);
+    TTChecksum       checksum;
+    for (size_t i = 0; i < header.cluster_count; i++) {
+        ClusterWords<ENTRIES> words;
+        std::memcpy(&words, data + i * sizeof(words), sizeof(words));
+        checksum.update(words);
+    }
+    if (checksum.digest(header.cluster_count) != header.checksum) {
+        munmap(base, file_size);
+        return TTFileStatus::ChecksumMismatch;
+    }
+
+    // std::atomic<u64> is lock-free and has the same representation as u64
+    static_assert(std::atomic<u64>::is_always_lock_free);
+    clusters = unique_ptr_huge_page<TTClusterMemory<ENTRIES>[]>(
+      reinterpret_cast<TTClusterMemory<ENTRIES>*>(static_cast<std::byte*>(base)
+                                                  + sizeof(TTFileHeader)),
+      [base, file_size](TTClusterMemory<ENTRIES>*) {
+          munmap(base, file_size);
+      });
+    return TTFileStatus::Ok;
+}
+#endif
+
+template<usize ENTRIES>
+TTFileStatus TranspositionTable<ENTRIES>::load(const std::string& path, bool map) {
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file) {
+        return TTFileStatus::OpenFailed;
+    }
+    auto file_size = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    TTFileHeader header;
+    if (file_size < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != TT_FILE_MAGIC || header.version != TT_FILE_VERSION
+        || header.cluster_bytes != sizeof(ClusterMemory) || header.entries_per_cluster != ENTRIES
+        || header.cluster_count == 0
+        || header.cluster_count > TT_FILE_MAX_BYTES / sizeof(ClusterMemory)) {
+        return TTFileStatus::BadHeader;
+    }
+    size_t payload = file_size - sizeof(header);
+    if (payload % sizeof(ClusterMemory) != 0
+        || payload / sizeof(ClusterMemory) != header.cluster_count) {
+        return TTFileStatus::SizeMismatch;
+    }
+
+    // Only replace the current table once the new one is known to be good
+    unique_ptr_huge_page<ClusterMemory[]> clusters;
+    TTFileStatus                          status;
+#ifdef __linux__
+    status = map ? map_clusters<ENTRIES>(path, file_size, header, clusters)
+                 : read_clusters<ENTRIES>(file, header, clusters);
+#else
+    (void)map;
+    status = read_clusters<ENTRIES>(file, header, clusters);
+#endif
+    if (status != TTFileStatus::Ok) {
+        return status;
+    }
+
+    m_clusters = std::move(clusters);
+    m_size     = header.cluster_count;
+    m_age      = header.age & AGE_MASK;
+    interleave();
+    return TTFileStatus::Ok;
+}
+
+template class TranspositionTable<3>;
+template class TranspositionTable<6>;
+#if TT_BUCKET_ENTRIES != 3 && TT_BUCKET_ENTRIES != 6
+template class TranspositionTable<TT_BUCKET_ENTRIES>;
+#endif
+
 }  // namespace Clockwork
@@ -5,6 +5,8 @@
 #include <array>
 #include <atomic>
 #include <bit>
+#include <string>
+#include <string_view>
 
 namespace Clockwork {
 
@@ -34,35 +36,51 @@ struct TTEntry {
     }
 };
 
+// Entries per bucket of the engine's table. Up to three entries share a 32 byte cluster, so two
+// clusters fit in a cache line; with four to six entries a cluster has the cache line to itself.
+#ifndef TT_BUCKET_ENTRIES
+    #define TT_BUCKET_ENTRIES 3
+#endif
+
+template<usize ENTRIES>
 struct TTCluster {
-    std::array<TTEntry, 3> entries;
-    std::array<u8, 2>      padding;
+    static_assert(ENTRIES >= 1 && ENTRIES <= 6);
+
+    static constexpr usize BYTES = ENTRIES * sizeof(TTEntry) <= 32 ? 32 : 64;
+
+    std::array<TTEntry, ENTRIES>                      entries;
+    std::array<u8, BYTES - ENTRIES * sizeof(TTEntry)> padding;
 };
 
+template<usize ENTRIES>
 struct TTClusterMemory {
-    alignas(32) std::array<std::atomic<u64>, 4> data;
-
-    [[nodiscard]] auto load() const -> TTCluster {
-        std::array<u64, 4> out;
-        out[0] = this->data[0].load(std::memory_order_relaxed);
-        out[1] = this->data[1].load(std::memory_order_relaxed);
-        out[2] = this->data[2].load(std::memory_order_relaxed);
-        out[3] = this->data[3].load(std::memory_order_relaxed);
-        return std::bit_cast<TTCluster>(out);
+    using Cluster = TTCluster<ENTRIES>;
+
+    static constexpr usize WORDS = Cluster::BYTES / sizeof(u64);
+
+    alignas(Cluster::BYTES) std::array<std::atomic<u64>, WORDS> data;
+
+    [[nodiscard]] auto load() const -> Cluster {
+        std::array<u64, WORDS> out;
+        for (usize i = 0; i < WORDS; i++) {
+            out[i] = this->data[i].load(std::memory_order_relaxed);
+        }
+        return std::bit_cast<Cluster>(out);
     }
 
-    auto store(TTCluster cluster) {
-        std::array<u64, 4> mem = std::bit_cast<std::array<u64, 4>>(cluster);
-        this->data[0].store(mem[0], std::memory_order_relaxed);
-        this->data[1].store(mem[1], std::memory_order_relaxed);
-        this->data[2].store(mem[2], std::memory_order_relaxed);
-        this->data[3].store(mem[3], std::memory_order_relaxed);
+    auto store(Cluster cluster) {
+        std::array<u64, WORDS> mem = std::bit_cast<std::array<u64, WORDS>>(cluster);
+        for (usize i = 0; i < WORDS; i++) {
+            this->data[i].store(mem[i], std::memory_order_relaxed);
+        }
     }
 };
 
 static_assert(sizeof(TTEntry) == 10 * sizeof(u8));
-static_assert(sizeof(TTCluster) == 32 * sizeof(u8));
-static_assert(sizeof(TTClusterMemory) == 32 * sizeof(u8));
+static_assert(sizeof(TTCluster<3>) == 32 * sizeof(u8));
+static_assert(sizeof(TTClusterMemory<3>) == 32 * sizeof(u8));
+static_assert(sizeof(TTCluster<6>) == 64 * sizeof(u8));
+static_assert(sizeof(TTClusterMemory<6>) == 64 * sizeof(u8));
 
 struct TTData {
     Value eval;
@@ -82,15 +100,31 @@ struct TTData {
     }
 };
 
-class TT {
+// Result of saving or loading the table with savehash/loadhash.
+enum class TTFileStatus {
+    Ok,
+    OpenFailed,
+    IoError,
+    BadHeader,
+    SizeMismatch,
+    ChecksumMismatch,
+};
+
+std::string_view to_string(TTFileStatus status);
+
+template<usize ENTRIES>
+class TranspositionTable {
 public:
+    using Cluster       = TTCluster<ENTRIES>;
+    using ClusterMemory = TTClusterMemory<ENTRIES>;
+
     static constexpr size_t DEFAULT_SIZE_MB = 16;
     static constexpr size_t TT_ALIGNMENT    = 64;
 
     static constexpr u8 MAX_AGE  = 32;
     static constexpr u8 AGE_MASK = 0x1F;
 
-    TT(size_t mb = DEFAULT_SIZE_MB);
+    TranspositionTable(size_t mb = DEFAULT_SIZE_MB);
 
     std::optional<TTData> probe(const Position& position, i32 ply) const;
     void                  store(const Position& position,
@@ -103,15 +137,41 @@ public:
                                 Bound           bound);
     void                  resize(size_t mb, usize thread_count);
     void                  clear(usize thread_count);
+    void                  interleave();
     void                  increment_age();
     i32                   hashfull() const;
-    TTClusterMemory*      addr_key(const u64 key) const;
+    ClusterMemory*        addr_key(const u64 key) const;
 
+    [[nodiscard]] size_t size_bytes() const {
+        return m_size * sizeof(ClusterMemory);
+    }
+    [[nodiscard]] MemoryRegion memory() const {
+        return {m_clusters.get(), size_bytes()};
+    }
+
+    // Persists the table so that a later process can continue from it. The loaded table replaces
+    // the current one, including its size. With `map` set, the file is mapped copy-on-write
+    // instead of being read in, so only the pages the search actually touches get copied.
+    TTFileStatus save(const std::string& path) const;
+    TTFileStatus load(const std::string& path, bool map);
 
 private:
-    unique_ptr_huge_page<TTClusterMemory[]> m_clusters;
-    size_t                                  m_size;
-    u8                                      m_age;
+    unique_ptr_huge_page<ClusterMemory[]> m_clusters;
+    size_t                                m_size;
+    u8                                    m_age;
+
+    [[nodiscard]] i32 replacement_score(const TTEntry& entry) const;
+};
+
+extern template class TranspositionTable<3>;
+extern template class TranspositionTable<6>;
+#if TT_BUCKET_ENTRIES != 3 && TT_BUCKET_ENTRIES != 6
+extern template class TranspositionTable<TT_BUCKET_ENTRIES>;
+#endif
+
+class TT : public TranspositionTable<TT_BUCKET_ENTRIES> {
+public:
+    using TranspositionTable::TranspositionTable;
 };
 
 }  // namespace Clockwork
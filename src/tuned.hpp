@@ -58,6 +58,9 @@ namespace Clockwork::tuned {
     TUNE(razor_margin, 657, 353, 1414, 53, 0.002)                 \
     NO_TUNE(lmp_depth_mult, 3, 1, 20, 0.5, 0.002)                 \
                                                                   \
+    /* Lazy Eval */                                               \
+    TUNE(lazy_eval_margin, 900, 450, 1800, 68, 0.002)             \
+                                                                  \
     /* Futility Pruning */                                        \
     TUNE(ffp_margin_base, 429, 250, 1000, 38, 0.002)              \
     TUNE(ffp_margin_mult, 95, 50, 200, 8, 0.002)                  \
@@ -3,11 +3,116 @@
 #include "value.hpp"
 
 #include "util/types.hpp"
+#include <algorithm>
 #include <cassert>
-#include <vector>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
 
 namespace Clockwork::Autograd {
 
+// Contiguous, cache line aligned storage that is filled by bumping an end index and emptied by
+// moving that index back. Capacity only grows when a push does not fit; once sized for a full
+// micro-batch, resets never touch the allocator again.
+template<typename T>
+class BumpBuffer {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+public:
+    static constexpr usize ALIGNMENT = 64;
+
+    BumpBuffer() = default;
+
+    ~BumpBuffer() {
+        release();
+    }
+
+    BumpBuffer(const BumpBuffer&)            = delete;
+    BumpBuffer& operator=(const BumpBuffer&) = delete;
+
+    void reserve(usize n) {
+        if (n <= m_capacity) {
+            return;
+        }
+
+        T* data = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ALIGNMENT}));
+        if (m_size > 0) {
+            std::memcpy(static_cast<void*>(data), m_data, m_size * sizeof(T));
+        }
+        release();
+
+        m_data     = data;
+        m_capacity = n;
+    }
+
+    inline u32 push(const T& value) {
+        if (m_size == m_capacity) [[unlikely]] {
+            reserve(std::max<usize>(1024, m_capacity * 2));
+        }
+        std::construct_at(m_data + m_size, value);
+        return static_cast<u32>(m_size++);
+    }
+
+    inline T& operator[](usize i) {
+        assert(i < m_size);
+        return m_data[i];
+    }
+
+    inline const T& operator[](usize i) const {
+        assert(i < m_size);
+        return m_data[i];
+    }
+
+    inline T* data() {
+        return m_data;
+    }
+    inline const T* data() const {
+        return m_data;
+    }
+
+    inline T* begin() {
+        return m_data;
+    }
+    inline T* end() {
+        return m_data + m_size;
+    }
+
+    inline const T& back() const {
+        assert(m_size > 0);
+        return m_data[m_size - 1];
+    }
+
+    inline usize size() const {
+        return m_size;
+    }
+    inline bool empty() const {
+        return m_size == 0;
+    }
+    inline usize capacity() const {
+        return m_capacity;
+    }
+
+    void clear() {
+        m_size = 0;
+    }
+
+    void reset_to(usize n) {
+        m_size = std::min(m_size, n);
+    }
+
+private:
+    T*    m_data     = nullptr;
+    usize m_size     = 0;
+    usize m_capacity = 0;
+
+    void release() {
+        if (m_data) {
+            ::operator delete(m_data, std::align_val_t{ALIGNMENT});
+        }
+    }
+};
+
 class ValueArena {
 public:
     ValueArena() = default;
@@ -18,10 +123,8 @@ public:
     }
 
     inline u32 alloc(f64 value = 0.0, f64 grad = 0.0) {
-        u32 idx = static_cast<u32>(values.size());
-        values.push_back(value);
-        gradients.push_back(grad);
-        return idx;
+        gradients.push(grad);
+        return values.push(value);
     }
 
     inline u32 next_index() const {
@@ -62,12 +165,11 @@ public:
     }
 
     void reset_to(usize n) {
-        if (n < values.size()) {
-            values.resize(n);
-            gradients.resize(n);
-        }
+        values.reset_to(n);
+        gradients.reset_to(n);
     }
 
+
     inline f64* values_data() {
         return values.data();
     }
@@ -82,8 +184,8 @@ public:
     }
 
 private:
-    std::vector<f64> values;
-    std::vector<f64> gradients;
+    BumpBuffer<f64> values;
+    BumpBuffer<f64> gradients;
 };
 
 class PairArena {
@@ -96,10 +198,8 @@ public:
     }
 
     inline u32 alloc(f64x2 v = f64x2::zero(), f64x2 g = f64x2::zero()) {
-        u32 idx = static_cast<u32>(values.size());
-        values.push_back(v);
-        gradients.push_back(g);
-        return idx;
+        gradients.push(g);
+        return values.push(v);
     }
 
     inline u32 next_index() const {
@@ -162,12 +262,11 @@ public:
     }
 
     void reset_to(usize n) {
-        if (n < values.size()) {
-            values.resize(n);
-            gradients.resize(n);
-        }
+        values.reset_to(n);
+        gradients.reset_to(n);
     }
 
+
     // Pointer accessors for hot loops
     inline f64x2* values_data() {
         return values.data();
@@ -186,8 +285,8 @@ public:
     }
 
 private:
-    std::vector<f64x2> values;
-    std::vector<f64x2> gradients;
+    BumpBuffer<f64x2> values;
+    BumpBuffer<f64x2> gradients;
 };
 
 }  // namespace Clockwork::Autograd
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "tuning/info.hpp"
+#include "util/types.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace Clockwork::Autograd {
+
+// A checkpoint is a 64 byte header followed by the parameter values, the optimizer state and the
+// textual state of the shuffling RNG. Numbers are stored in native byte order, as checkpoints are
+// only meant to be resumed on the machine type that wrote them.
+struct CheckpointHeader {
+    static constexpr u64 MAGIC   = 0x3154504B43574325;  // "%CWCKPT1"
+    static constexpr u32 VERSION = 1;
+
+    u64 magic          = MAGIC;
+    u32 version        = VERSION;
+    u32 optimizer      = 0;
+    u64 value_count    = 0;
+    u64 pair_count     = 0;
+    u64 position_count = 0;
+    u64 epoch          = 0;
+    u64 rng_bytes      = 0;
+    u64 reserved       = 0;
+};
+
+static_assert(sizeof(CheckpointHeader) == 64);
+
+template<typename T>
+void write_array(std::ostream& os, const T* data, usize count) {
+    os.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+template<typename T>
+bool read_array(std::istream& is, T* data, usize count) {
+    return static_cast<bool>(
+      is.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count * sizeof(T))));
+}
+
+// Writes a checkpoint to resume from at `epoch`. The file is replaced only once fully written, so
+// a run killed mid-write keeps its previous checkpoint. Returns false if it could not be written.
+template<typename Optim>
+bool save_checkpoint(const std::string&  path,
+                     u64                 epoch,
+                     usize               position_count,
+                     const Parameters&   values,
+                     const Optim&        optim,
+                     const std::mt19937& rng) {
+    std::ostringstream rng_state;
+    rng_state << rng;
+    const std::string rng_text = rng_state.str();
+
+    CheckpointHeader header;
+    header.optimizer      = Optim::CHECKPOINT_ID;
+    header.value_count    = values.parameters.size();
+    header.pair_count     = values.pair_parameters.size();
+    header.position_count = position_count;
+    header.epoch          = epoch;
+    header.rng_bytes      = rng_text.size();
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+        if (!out) {
+            std::cerr << "Error opening " << temp_path << "\n";
+            return false;
+        }
+
+        write_array(out, &header, 1);
+        write_array(out, values.parameters.data(), values.parameters.size());
+        write_array(out, flat_data(values.pair_parameters), 2 * values.pair_parameters.size());
+        optim.save_state(out);
+        write_array(out, rng_text.data(), rng_text.size());
+
+        if (!out.flush()) {
+            std::cerr << "Error writing " << temp_path << "\n";
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        std::cerr << "Error renaming " << temp_path << " to " << path << ": " << ec.message()
+                  << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Restores `values`, `optim` and `rng` from a checkpoint and returns the epoch to resume at. Throws
+// std::runtime_error if the file cannot be read or was written for different parameters or a
+// different optimizer. A different position count only warns, as the run can still continue.
+template<typename Optim>
+u64 load_checkpoint(const std::string& path,
+                    usize              position_count,
+                    Parameters&        values,
+                    Optim&             optim,
+                    std::mt19937&      rng) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw std::runtime_error("Error opening " + path);
+    }
+
+    CheckpointHeader header;
+    if (!read_array(in, &header, 1) || header.magic != CheckpointHeader::MAGIC
+        || header.version != CheckpointHeader::VERSION) {
+        throw std::runtime_error(path + " is not a checkpoint");
+    }
+    if (header.optimizer != Optim::CHECKPOINT_ID) {
+        throw std::runtime_error(path + " was written by a different optimizer");
+    }
+    if (header.value_count != values.parameters.size()
+        || header.pair_count != values.pair_parameters.size()) {
+        throw std::runtime_error(path + " has " + std::to_string(header.value_count) + " values and "
+                                 + std::to_string(header.pair_count)
+                                 + " pairs, which does not match the eval");
+    }
+    if (header.position_count != position_count) {
+        std::cerr << "Warning: " << path << " was written for " << header.position_count
+                  << " positions, resuming with " << position_count << "\n";
+    }
+
+    Parameters  loaded = values;
+    std::string rng_text(header.rng_bytes, '\0');
+    if (!read_array(in, loaded.parameters.data(), loaded.parameters.size())
+        || !read_array(in, flat_data(loaded.pair_parameters), 2 * loaded.pair_parameters.size())
+        || !optim.load_state(in) || !read_array(in, rng_text.data(), rng_text.size())) {
+        throw std::runtime_error(path + " is truncated");
+    }
+
+    std::istringstream rng_state{rng_text};
+    if (!(rng_state >> rng)) {
+        throw std::runtime_error(path + " has an invalid RNG state");
+    }
+
+    values = std::move(loaded);
+    return header.epoch;
+}
+
+}  // namespace Clockwork::Autograd
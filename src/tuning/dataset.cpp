@@ -0,0 +1,209 @@
+#include "tuning/dataset.hpp"
+#include "util/types.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Clockwork::Autograd {
+
+Dataset::Dataset(const std::string& file_path) :
+    m_file_path(file_path) {
+    map_file();
+}
+
+Dataset::~Dataset() {
+    if (m_mapped_data) {
+        munmap(m_mapped_data, m_file_size);
+    }
+}
+
+void Dataset::map_file() {
+    int fd = ::open(m_file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open dataset " + m_file_path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(DatasetHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Dataset " + m_file_path + " is too small");
+    }
+    m_file_size = static_cast<size_t>(st.st_size);
+
+    void* base = mmap(nullptr, m_file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Could not map dataset " + m_file_path);
+    }
+
+    // The destructor does not run when the constructor throws
+    auto fail = [&](const std::string& reason) {
+        munmap(base, m_file_size);
+        throw std::runtime_error("Dataset " + m_file_path + " " + reason);
+    };
+
+    const auto* header = static_cast<const DatasetHeader*>(base);
+    if (header->magic != DatasetHeader::MAGIC || header->version != DatasetHeader::VERSION
+        || header->record_bytes != sizeof(PackedPosition)) {
+        fail("has an unsupported header");
+    }
+    size_t payload = m_file_size - sizeof(DatasetHeader);
+    if (payload % sizeof(PackedPosition) != 0
+        || header->count != payload / sizeof(PackedPosition)) {
+        fail("is truncated");
+    }
+    m_mapped_data = base;
+
+    // Training reads the records once per position, in order
+    madvise(base, m_file_size, MADV_SEQUENTIAL);
+
+    m_records = {reinterpret_cast<const PackedPosition*>(static_cast<const std::byte*>(base)
+                                                         + sizeof(DatasetHeader)),
+                 static_cast<size_t>(header->count)};
+}
+
+static std::optional<GameResult> parse_result(std::string_view str) {
+    if (str == "w") {
+        return GameResult::WhiteWin;
+    } else if (str == "d") {
+        return GameResult::Draw;
+    } else if (str == "b") {
+        return GameResult::BlackWin;
+    }
+    return std::nullopt;
+}
+
+// Sizes and modification times of the inputs mixed into one value, or nullopt if one is missing
+static std::optional<u64> source_stamp(const std::vector<std::string>& inputs) {
+    u64 stamp = inputs.size();
+    auto mix  = [&](u64 value) {
+        stamp = (stamp ^ value) * 0x9E3779B97F4A7C15;
+        stamp ^= stamp >> 32;
+    };
+
+    for (const auto& filename : inputs) {
+        std::error_code ec;
+        auto            size  = std::filesystem::file_size(filename, ec);
+        auto            mtime = std::filesystem::last_write_time(filename, ec);
+        if (ec) {
+            return std::nullopt;
+        }
+        mix(static_cast<u64>(size));
+        mix(static_cast<u64>(mtime.time_since_epoch().count()));
+    }
+    return stamp;
+}
+
+bool is_dataset_current(const std::vector<std::string>& inputs, const std::string& output) {
+    std::ifstream in{output, std::ios::binary};
+    DatasetHeader header;
+    if (!in || !in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != DatasetHeader::MAGIC || header.version != DatasetHeader::VERSION) {
+        return false;
+    }
+
+    auto stamp = source_stamp(inputs);
+    return !stamp || *stamp == header.source_stamp;
+}
+
+std::optional<size_t> convert_text_dataset(const std::vector<std::string>& inputs,
+                                           const std::string&              output) {
+    // Written under a temporary name, so an interrupted conversion never leaves a dataset behind
+    std::string   temp_output = output + ".tmp";
+    std::ofstream out{temp_output, std::ios::binary | std::ios::trunc};
+    if (!out) {
+        std::cerr << "Error opening " << temp_output << "\n";
+        return std::nullopt;
+    }
+
+    auto fail = [&]() -> std::optional<size_t> {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(temp_output, ec);
+        return std::nullopt;
+    };
+
+    // Written again with the final count once all inputs are converted. The stamp is taken before
+    // reading, so that inputs changed during the conversion count as stale. Missing inputs are
+    // reported when they are opened below.
+    DatasetHeader header;
+    header.source_stamp = source_stamp(inputs).value_or(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<PackedPosition> buffer;
+    buffer.reserve(1 << 16);
+    auto flush = [&] {
+        out.write(reinterpret_cast<const char*>(buffer.data()),
+                  static_cast<std::streamsize>(buffer.size() * sizeof(PackedPosition)));
+        header.count += buffer.size();
+        buffer.clear();
+    };
+
+    for (const auto& filename : inputs) {
+        std::ifstream in{filename};
+        if (!in) {
+            std::cerr << "Error opening " << filename << "\n";
+            return fail();
+        }
+
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t sep = line.find(';');
+            if (sep == std::string::npos) {
+                std::cerr << "Bad line in " << filename << ": " << line << "\n";
+                continue;
+            }
+
+            auto parsed = Position::parse(std::string_view{line}.substr(0, sep));
+            if (!parsed) {
+                std::cerr << "Failed to parse FEN in " << filename << ": " << line.substr(0, sep)
+                          << "\n";
+                continue;
+            }
+
+            std::string result = line.substr(sep + 1);
+            result.erase(std::remove_if(result.begin(), result.end(), ::isspace), result.end());
+
+            auto r = parse_result(result);
+            if (!r) {
+                std::cerr << "Invalid result in " << filename << ": " << line << "\n";
+                continue;
+            }
+
+            PackedPosition packed = parsed->pack();
+            packed.result         = *r;
+            buffer.push_back(packed);
+            if (buffer.size() == buffer.capacity()) {
+                flush();
+            }
+        }
+    }
+    flush();
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::cerr << "Error writing " << temp_output << "\n";
+        return fail();
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_output, output, ec);
+    if (ec) {
+        std::cerr << "Error renaming " << temp_output << " to " << output << "\n";
+        return fail();
+    }
+
+    return static_cast<size_t>(header.count);
+}
+
+}  // namespace Clockwork::Autograd
@@ -1,53 +1,81 @@
 #pragma once
 
-#include "graph.hpp"
-#include "value.hpp"
+#include "packed_position.hpp"
+#include "position.hpp"
+#include "util/types.hpp"
 
-#include <cstring>
-#include <fcntl.h>
-#include <memory>
-#include <stdexcept>
+#include <optional>
+#include <span>
 #include <string>
-#include <sys/mman.h>
-#include <unistd.h>
 #include <vector>
 
 namespace Clockwork::Autograd {
 
+// A packed dataset is a 32 byte header followed by one PackedPosition per training position, with
+// the game result stored in the record. The header remembers the sizes and modification times of
+// the text files it was converted from, so that a stale conversion is noticed.
+struct DatasetHeader {
+    static constexpr u64 MAGIC   = 0x3141544144574325;  // "%CWDATA1"
+    static constexpr u32 VERSION = 1;
+
+    u64 magic        = MAGIC;
+    u32 version      = VERSION;
+    u32 record_bytes = sizeof(PackedPosition);
+    u64 count        = 0;
+    u64 source_stamp = 0;
+};
+
+static_assert(sizeof(DatasetHeader) == 32);
+
+// Game result of a record from white's point of view: 1 for a win, 0.5 for a draw and 0 for a loss
+inline f64 training_result(const PackedPosition& record) {
+    return static_cast<f64>(record.result) * 0.5;
+}
+
+// Read-only view of a packed dataset file, mapped into memory. Records are decoded on request, so
+// opening a dataset costs no parsing and no per-position allocations.
 class Dataset {
 private:
-    std::string              m_file_path;
-    char*                    m_mapped_data;
-    size_t                   m_file_size;
-    std::vector<std::string> m_lines;
+    std::string                     m_file_path;
+    void*                           m_mapped_data = nullptr;
+    size_t                          m_file_size   = 0;
+    std::span<const PackedPosition> m_records;
 
     void map_file();
-    void parse_lines();
 
 public:
-    Dataset(const std::string& file_path);
+    // Throws std::runtime_error if the file cannot be mapped or is not a packed dataset
+    explicit Dataset(const std::string& file_path);
     ~Dataset();
 
-    const std::vector<std::string>& lines() const {
-        return m_lines;
-    }
+    Dataset(const Dataset&)            = delete;
+    Dataset& operator=(const Dataset&) = delete;
+
     size_t size() const {
-        return m_lines.size();
+        return m_records.size();
     }
-};
 
-class DataLoader {
-private:
-    const Dataset& m_dataset;
-    size_t         m_batch_size;
-    size_t         m_index;
+    const PackedPosition& record(size_t index) const {
+        return m_records[index];
+    }
 
-public:
-    DataLoader(const Dataset& dataset, size_t batch_size);
+    std::optional<Position> position(size_t index) const {
+        return Position::unpack(m_records[index]);
+    }
 
-    bool                     has_next() const;
-    std::vector<std::string> next_batch();
-    void                     reset();
+    f64 result(size_t index) const {
+        return training_result(m_records[index]);
+    }
 };
 
+// True if `output` is a packed dataset converted from `inputs` as they are now. If the inputs are
+// gone, any readable packed dataset counts as current, so packed datasets can be used on their own.
+bool is_dataset_current(const std::vector<std::string>& inputs, const std::string& output);
+
+// Converts text datasets with one "<fen>;<w|d|b>" line per position into a packed dataset.
+// Malformed lines are reported and skipped. Returns the number of positions written, or nullopt if
+// a file could not be opened or written.
+std::optional<size_t> convert_text_dataset(const std::vector<std::string>& inputs,
+                                           const std::string&              output);
+
 }  // namespace Clockwork::Autograd
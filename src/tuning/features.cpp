@@ -0,0 +1,268 @@
+#include "tuning/features.hpp"
+#include "evaluation.hpp"
+#include "position.hpp"
+#include "tuning/globals.hpp"
+#include "tuning/graph.hpp"
+#include "util/types.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace Clockwork::Autograd {
+
+static Position unpack_record(const PackedPosition& record) {
+    auto position = Position::unpack(record);
+    if (!position) {
+        throw std::runtime_error("Invalid training record");
+    }
+    return *position;
+}
+
+// Narrows a value into the packed format, which a linear eval over feature counts always fits
+template<typename T>
+static T narrow(f64 value, const char* what) {
+    if (value != std::round(value) || value < static_cast<f64>(std::numeric_limits<T>::min())
+        || value > static_cast<f64>(std::numeric_limits<T>::max())) {
+        throw std::runtime_error(std::string{what} + " does not fit the packed feature format");
+    }
+    return static_cast<T>(value);
+}
+
+FeatureSet::FeatureSet(std::span<const PackedPosition> records, u32 thread_count) {
+    struct Chunk {
+        std::vector<PositionFeatures> positions;
+        std::vector<Coefficient>      coefficients;
+        std::vector<Offsets>          offsets;
+    };
+
+    const ParameterCountInfo counts = Globals::get().get_parameter_counts();
+    if (std::max(counts.parameter_count, counts.pair_parameter_count)
+        > std::numeric_limits<u16>::max() + usize{1}) {
+        throw std::runtime_error("Too many parameters for the packed feature format");
+    }
+
+    // Coefficients are read off the gradients of each term, one half of a pair term at a time.
+    // Since the terms are linear, the parameter values they are taken at do not matter.
+    auto extract = [&](size_t begin, size_t end, Chunk& chunk) {
+        Graph&     graph  = Graph::get();
+        Parameters values = graph.get_all_parameter_values();
+
+        std::vector<f64> mg_coefficients(counts.pair_parameter_count, 0.0);
+
+        auto require_no_value_gradients = [&] {
+            for (usize i = 0; i < counts.parameter_count; i++) {
+                if (graph.get_gradient(static_cast<u32>(i)) != 0.0) {
+                    throw std::runtime_error("A pair eval term depends on a value parameter");
+                }
+            }
+        };
+
+        for (size_t p = begin; p < end; p++) {
+            EvalTerms terms = evaluate_terms(unpack_record(records[p]));
+
+            PositionFeatures features{};
+            features.begin       = chunk.coefficients.size();
+            features.phase       = narrow<u8>(terms.phase, "The phase");
+            features.eg_scale[0] = narrow<u8>(terms.eg_scale[0], "An eg scale");
+            features.eg_scale[1] = narrow<u8>(terms.eg_scale[1], "An eg scale");
+
+            Offsets offsets{};
+
+            const std::array<PairHandle, PAIR_TERMS> pair_terms = {
+              terms.linear, terms.white_king_attack, terms.black_king_attack};
+
+            for (usize term = 0; term < PAIR_TERMS; term++) {
+                graph.zero_all_grads();
+                graph.backward(pair_terms[term], f64x2::make(1.0, 0.0));
+                require_no_value_gradients();
+                for (usize i = 0; i < counts.pair_parameter_count; i++) {
+                    f64x2 grad = graph.get_pair_gradients(static_cast<u32>(i));
+                    if (grad.second() != 0.0) {
+                        throw std::runtime_error("An eval term mixes its mg and eg halves");
+                    }
+                    mg_coefficients[i] = grad.first();
+                }
+
+                graph.zero_all_grads();
+                graph.backward(pair_terms[term], f64x2::make(0.0, 1.0));
+                require_no_value_gradients();
+
+                f64x2  offset = pair_terms[term].get_values();
+                size_t first  = chunk.coefficients.size();
+                for (usize i = 0; i < counts.pair_parameter_count; i++) {
+                    f64x2 grad = graph.get_pair_gradients(static_cast<u32>(i));
+                    if (grad.first() != 0.0) {
+                        throw std::runtime_error("An eval term mixes its mg and eg halves");
+                    }
+                    if (mg_coefficients[i] == 0.0 && grad.second() == 0.0) {
+                        continue;
+                    }
+
+                    Coefficient coeff{static_cast<u16>(i),
+                                      narrow<i8>(mg_coefficients[i], "A coefficient"),
+                                      narrow<i8>(grad.second(), "A coefficient")};
+                    chunk.coefficients.push_back(coeff);
+                    offset = f64x2::sub(offset, f64x2::mul(f64x2::make(coeff.mg, coeff.eg),
+                                                           values.pair_parameters[i]));
+                }
+                offsets.pairs[term] = offset;
+                features.pair_counts[term] =
+                  narrow<u8>(static_cast<f64>(chunk.coefficients.size() - first), "A term size");
+            }
+
+            graph.zero_all_grads();
+            graph.backward(terms.winnable);
+
+            f64    offset = terms.winnable.get_value();
+            size_t first  = chunk.coefficients.size();
+            for (usize i = 0; i < counts.pair_parameter_count; i++) {
+                f64x2 grad = graph.get_pair_gradients(static_cast<u32>(i));
+                if (grad.first() != 0.0 || grad.second() != 0.0) {
+                    throw std::runtime_error("The winnable term depends on a pair parameter");
+                }
+            }
+            for (usize i = 0; i < counts.parameter_count; i++) {
+                f64 grad = graph.get_gradient(static_cast<u32>(i));
+                if (grad == 0.0) {
+                    continue;
+                }
+
+                Coefficient coeff{static_cast<u16>(i), narrow<i8>(grad, "A coefficient"), 0};
+                chunk.coefficients.push_back(coeff);
+                offset -= static_cast<f64>(coeff.mg) * values.parameters[i];
+            }
+            offsets.winnable = offset;
+            features.value_count =
+              narrow<u8>(static_cast<f64>(chunk.coefficients.size() - first), "A term size");
+
+            if (!offsets.is_zero()) {
+                chunk.offsets.push_back(offsets);
+                features.offsets = static_cast<u32>(chunk.offsets.size());
+            }
+
+            chunk.positions.push_back(features);
+
+            graph.cleanup();
+        }
+
+        graph.zero_grad();
+    };
+
+    thread_count = std::max<u32>(1, thread_count);
+
+    const size_t chunk_size = (records.size() + thread_count - 1) / thread_count;
+
+    std::vector<Chunk>              chunks(thread_count);
+    std::vector<std::exception_ptr> errors(thread_count);
+
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            size_t begin = std::min(records.size(), chunk_size * t);
+            size_t end   = std::min(records.size(), begin + chunk_size);
+            try {
+                extract(begin, end, chunks[t]);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    m_positions.reserve(records.size());
+    m_offsets.push_back(Offsets{});
+    for (Chunk& chunk : chunks) {
+        u64 coefficient_base = m_coefficients.size();
+        u64 offset_base      = m_offsets.size() - 1;
+        if (offset_base + chunk.offsets.size() > std::numeric_limits<u32>::max()) {
+            throw std::runtime_error("Too many nonzero offsets for the packed feature format");
+        }
+        for (PositionFeatures features : chunk.positions) {
+            features.begin += coefficient_base;
+            if (features.offsets != 0) {
+                features.offsets += static_cast<u32>(offset_base);
+            }
+            m_positions.push_back(features);
+        }
+        m_coefficients.insert(m_coefficients.end(), chunk.coefficients.begin(),
+                              chunk.coefficients.end());
+        m_offsets.insert(m_offsets.end(), chunk.offsets.begin(), chunk.offsets.end());
+        chunk = {};
+    }
+}
+
+ValueHandle FeatureSet::forward(size_t i, const Parameters& params, FeatureInputs& inputs) const {
+    const PositionFeatures& features = m_positions[i];
+    const Offsets&          offsets  = m_offsets[features.offsets];
+
+    const Coefficient* coeff = m_coefficients.data() + features.begin;
+    for (usize term = 0; term < PAIR_TERMS; term++) {
+        f64x2 sum = offsets.pairs[term];
+        for (u32 j = 0; j < features.pair_counts[term]; j++, coeff++) {
+            sum = f64x2::madd(sum, f64x2::make(coeff->mg, coeff->eg),
+                              params.pair_parameters[coeff->index]);
+        }
+        inputs.pairs[term] = PairHandle::create(sum);
+    }
+
+    f64 winnable = offsets.winnable;
+    for (u32 j = 0; j < features.value_count; j++, coeff++) {
+        winnable += static_cast<f64>(coeff->mg) * params.parameters[coeff->index];
+    }
+    inputs.winnable = ValueHandle::create(winnable);
+
+    return evaluate_head({inputs.pairs[0], inputs.pairs[1], inputs.pairs[2], inputs.winnable,
+                          features.phase, {features.eg_scale[0], features.eg_scale[1]}});
+}
+
+void FeatureSet::backward(size_t i, const FeatureInputs& inputs, Parameters& grads) const {
+    const PositionFeatures& features = m_positions[i];
+
+    const Coefficient* coeff = m_coefficients.data() + features.begin;
+    for (usize term = 0; term < PAIR_TERMS; term++) {
+        f64x2 grad = inputs.pairs[term].get_gradients();
+        for (u32 j = 0; j < features.pair_counts[term]; j++, coeff++) {
+            f64x2& target = grads.pair_parameters[coeff->index];
+            target        = f64x2::madd(target, f64x2::make(coeff->mg, coeff->eg), grad);
+        }
+    }
+
+    f64 grad = inputs.winnable.get_gradient();
+    for (u32 j = 0; j < features.value_count; j++, coeff++) {
+        grads.parameters[coeff->index] += static_cast<f64>(coeff->mg) * grad;
+    }
+}
+
+f64 FeatureSet::max_error(std::span<const PackedPosition> records,
+                          const Parameters&               params,
+                          size_t                          samples) const {
+    Graph& graph = Graph::get();
+    graph.copy_parameter_values(params);
+
+    const size_t step = std::max<size_t>(1, size() / std::max<size_t>(1, samples));
+
+    f64           error = 0.0;
+    FeatureInputs inputs;
+    for (size_t i = 0; i < size(); i += step) {
+        f64 full   = evaluate_white_pov(unpack_record(records[i])).get_value();
+        f64 sparse = forward(i, params, inputs).get_value();
+        error      = std::max(error, std::abs(full - sparse));
+        graph.cleanup();
+    }
+
+    return error;
+}
+
+}  // namespace Clockwork::Autograd
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "packed_position.hpp"
+#include "tuning/info.hpp"
+#include "tuning/value.hpp"
+#include "util/types.hpp"
+#include "util/vec/sse2.hpp"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace Clockwork::Autograd {
+
+// Coefficient of one parameter in a term. The mg half of a pair term only ever depends on the mg
+// half of a parameter, and likewise for eg. Value parameters only use `mg`. Coefficients count
+// features, so they are small integers; extraction fails if one is not.
+struct Coefficient {
+    u16 index;
+    i8  mg;
+    i8  eg;
+};
+
+static_assert(sizeof(Coefficient) == 4);
+
+// Input nodes of one recorded position, read back after the backward pass
+struct FeatureInputs {
+    std::array<PairHandle, 3> pairs;
+    ValueHandle               winnable;
+};
+
+// Every term of evaluate_terms that is linear in the parameters, stored per position as a sparse
+// coefficient vector. A training step then only needs a few sparse dot products and the nonlinear
+// head on the tape, instead of recording the whole eval.
+class FeatureSet {
+public:
+    // Pair terms, in the order of EvalTerms
+    static constexpr usize PAIR_TERMS = 3;
+
+    // Extracts the features of every record on `thread_count` threads, unpacking the positions as
+    // it goes. Throws std::runtime_error if a record is invalid or a term turns out not to be
+    // linear in the parameters.
+    FeatureSet(std::span<const PackedPosition> records, u32 thread_count);
+
+    size_t size() const {
+        return m_positions.size();
+    }
+
+    size_t coefficient_count() const {
+        return m_coefficients.size();
+    }
+
+    size_t memory_bytes() const {
+        return m_positions.size() * sizeof(PositionFeatures)
+             + m_coefficients.size() * sizeof(Coefficient) + m_offsets.size() * sizeof(Offsets);
+    }
+
+    // Records the eval of position `i` at `params` on the calling thread's graph, with the linear
+    // terms as input nodes
+    ValueHandle forward(size_t i, const Parameters& params, FeatureInputs& inputs) const;
+
+    // Scatters the gradients of the input nodes into `grads`
+    void backward(size_t i, const FeatureInputs& inputs, Parameters& grads) const;
+
+    // Largest difference between the sparse and the full eval at `params`, over `samples`
+    // positions spread across the set
+    f64 max_error(std::span<const PackedPosition> records,
+                  const Parameters&               params,
+                  size_t                          samples) const;
+
+private:
+    // Constant parts of the terms. They are zero for almost every position, so positions share the
+    // all-zero entry 0.
+    struct Offsets {
+        std::array<f64x2, PAIR_TERMS> pairs;
+        f64                           winnable;
+
+        bool is_zero() const {
+            for (const f64x2& pair : pairs) {
+                if (pair.first() != 0.0 || pair.second() != 0.0) {
+                    return false;
+                }
+            }
+            return winnable == 0.0;
+        }
+    };
+
+    // The coefficients of a position are stored back to back: each pair term in order, then the
+    // winnable term.
+    struct PositionFeatures {
+        u64                        begin;
+        u32                        offsets;
+        std::array<u8, PAIR_TERMS> pair_counts;
+        u8                         value_count;
+        u8                         phase;
+        std::array<u8, 2>          eg_scale;
+    };
+
+    static_assert(sizeof(PositionFeatures) == 24);
+
+    std::vector<PositionFeatures> m_positions;
+    std::vector<Coefficient>      m_coefficients;
+    std::vector<Offsets>          m_offsets;
+};
+
+}  // namespace Clockwork::Autograd
@@ -13,10 +13,9 @@ Graph::Graph() {
     m_global_param_count = params.size();
     m_global_pair_count  = pair_params.size();
 
-    // reserve some headroom
+    // reserve some headroom, the rest is sized by the first pass
     m_values.reserve(m_global_param_count + 1024);
     m_pairs.reserve(m_global_pair_count + 1024);
-    m_tape.reserve(16384 * 2 * 16);
 
     for (auto* p : params) {
         m_values.alloc(p->default_value(), 0.0);
@@ -68,7 +67,7 @@ ValueHandle Graph::record_op(OpType op, ValueHandle lhs, ValueHandle rhs) {
 
     m_values.alloc(res, 0.0);
 
-    m_tape.push_back(Node::make_binary(op, out.index, lhs.index, rhs.index));
+    m_tape.push(Node::make_binary(op, out.index, lhs.index, rhs.index));
 
     return out;
 }
@@ -118,7 +117,7 @@ ValueHandle Graph::record_op(OpType op, ValueHandle lhs, f64 scalar) {
 
     m_values.alloc(res, 0.0);
 
-    m_tape.push_back(Node::make_scalar(op, out.index, lhs.index, scalar));
+    m_tape.push(Node::make_scalar(op, out.index, lhs.index, scalar));
 
     return out;
 }
@@ -142,7 +141,7 @@ PairHandle Graph::record_pair_op(OpType op, PairHandle lhs, PairHandle rhs) {
 
     m_pairs.alloc(res, f64x2::zero());
 
-    m_tape.push_back(Node::make_binary(op, out.index, lhs.index, rhs.index));
+    m_tape.push(Node::make_binary(op, out.index, lhs.index, rhs.index));
 
     return out;
 }
@@ -174,7 +173,7 @@ PairHandle Graph::record_pair_scalar(OpType op, PairHandle lhs, f64 scalar) {
 
     m_pairs.alloc(res, f64x2::zero());
 
-    m_tape.push_back(Node::make_scalar(op, out.index, lhs.index, scalar));
+    m_tape.push(Node::make_scalar(op, out.index, lhs.index, scalar));
 
     return out;
 }
@@ -213,7 +212,7 @@ PairHandle Graph::record_pair_value(OpType op, PairHandle lhs, ValueHandle rhs)
 
     m_pairs.alloc(res, f64x2::zero());
 
-    m_tape.push_back(Node::make_binary(op, out.index, lhs.index, rhs.index));
+    m_tape.push(Node::make_binary(op, out.index, lhs.index, rhs.index));
 
     return out;
 }
@@ -239,7 +238,7 @@ PairHandle Graph::record_pair_unary(OpType op, PairHandle input) {
 
     m_pairs.alloc(res, f64x2::zero());
 
-    m_tape.push_back(Node::make_scalar(op, out.index, input.index, 0.0));
+    m_tape.push(Node::make_scalar(op, out.index, input.index, 0.0));
 
     return out;
 }
@@ -260,7 +259,7 @@ PairHandle Graph::record_pair_value(OpType op, PairHandle lhs, PairHandle rhs) {
 
     m_pairs.alloc(res, f64x2::zero());
 
-    m_tape.push_back(Node::make_binary(op, out.index, lhs.index, rhs.index));
+    m_tape.push(Node::make_binary(op, out.index, lhs.index, rhs.index));
 
     return out;
 }
@@ -272,7 +271,7 @@ ValueHandle Graph::record_phase(PairHandle lhs, f64 alpha) {
 
     m_values.alloc(val, 0.0);
 
-    m_tape.push_back(Node::make_scalar(OpType::Phase, out.index, lhs.index, alpha));
+    m_tape.push(Node::make_scalar(OpType::Phase, out.index, lhs.index, alpha));
 
     return out;
 }
@@ -287,13 +286,13 @@ ValueHandle Graph::record_sum(const std::vector<ValueHandle>& inputs) {
 
     for (const auto& h : inputs) {
         res += m_values.val(h.index);
-        m_sum_buffer.push_back(h.index);
+        m_sum_buffer.push(h.index);
     }
 
     m_values.alloc(res, 0.0);
 
     // We reuse lhs_idx for offset, and rhs_idx for count
-    m_tape.push_back(Node::make_binary(OpType::Sum, out.index, offset, count));
+    m_tape.push(Node::make_binary(OpType::Sum, out.index, offset, count));
 
     return out;
 }
@@ -307,13 +306,27 @@ void Graph::backward() {
     // (This assumes the final output is always a ValueHandle)
     m_values.grad(m_tape.back().out()) = 1.0;
 
+    propagate();
+}
+
+void Graph::backward(ValueHandle output, f64 seed) {
+    m_values.grad(output.index) = seed;
+    propagate();
+}
+
+void Graph::backward(PairHandle output, f64x2 seed) {
+    m_pairs.grad(output.index) = seed;
+    propagate();
+}
+
+void Graph::propagate() {
     f64*   vals       = m_values.values_data();
     f64*   grads      = m_values.gradients_data();
     f64x2* pair_vals  = m_pairs.values_data();
     f64x2* pair_grads = m_pairs.gradients_data();
 
-    for (auto it = m_tape.rbegin(); it != m_tape.rend(); ++it) {
-        const Node& node = *it;
+    for (const Node* it = m_tape.end(); it != m_tape.begin();) {
+        const Node& node = *--it;
 
         const u32 out_idx = node.out();
 
@@ -590,10 +603,23 @@ void Graph::backward() {
 
 void Graph::cleanup() {
     // Keep global parameters + 1 for the permanent zero node
-    m_values.reset_to(m_global_param_count + 1);
-    m_pairs.reset_to(m_global_pair_count + 1);
+    const usize value_base = m_global_param_count + 1;
+    const usize pair_base  = m_global_pair_count + 1;
+
+    m_last_usage = {m_values.size() - value_base, m_pairs.size() - pair_base, m_tape.size(),
+                    m_sum_buffer.size()};
+
+    m_values.reset_to(value_base);
+    m_pairs.reset_to(pair_base);
     m_tape.clear();
     m_sum_buffer.clear();
+
+    // A quarter of headroom over this pass, since positions differ in how much tape they take.
+    // This only allocates while the buffers are still being sized, during the first micro-batches.
+    m_values.reserve(value_base + m_last_usage.values + m_last_usage.values / 4);
+    m_pairs.reserve(pair_base + m_last_usage.pairs + m_last_usage.pairs / 4);
+    m_tape.reserve(m_last_usage.nodes + m_last_usage.nodes / 4);
+    m_sum_buffer.reserve(m_last_usage.sum_inputs + m_last_usage.sum_inputs / 4);
 }
 
 void Graph::zero_grad() {
@@ -612,6 +638,15 @@ void Graph::zero_grad() {
     }
 }
 
+void Graph::zero_all_grads() {
+    for (usize i = 0; i < m_values.size(); ++i) {
+        m_values.grad(static_cast<u32>(i)) = 0.0;
+    }
+    for (usize i = 0; i < m_pairs.size(); ++i) {
+        m_pairs.grad(static_cast<u32>(i)) = f64x2::zero();
+    }
+}
+
 void Graph::copy_parameter_values(const Parameters& source) {
     if (source.parameters.size() != m_global_param_count
         || source.pair_parameters.size() != m_global_pair_count) {
@@ -652,6 +687,12 @@ Parameters Graph::get_all_parameter_gradients() const {
     return p;
 }
 
+void Graph::accumulate_parameter_gradients(Parameters& target) const {
+    add_f64(target.parameters.data(), m_values.gradients_data(), m_global_param_count);
+    add_f64(flat_data(target.pair_parameters),
+            reinterpret_cast<const f64*>(m_pairs.gradients_data()), 2 * m_global_pair_count);
+}
+
 // Mutation Helpers
 
 void Graph::add_value_gradient(u32 idx, f64 delta) {
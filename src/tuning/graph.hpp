@@ -11,16 +11,31 @@
 
 namespace Clockwork::Autograd {
 
+// What one pass between cleanups put on the tape, beyond the global parameters
+struct TapeUsage {
+    usize values     = 0;
+    usize pairs      = 0;
+    usize nodes      = 0;
+    usize sum_inputs = 0;
+
+    usize bytes() const {
+        return values * 2 * sizeof(f64) + pairs * 2 * sizeof(f64x2) + nodes * sizeof(Node)
+             + sum_inputs * sizeof(u32);
+    }
+};
+
 class Graph {
 private:
     ValueArena m_values;
     PairArena  m_pairs;
 
     // Tape (Linear record of operations)
-    std::vector<Node> m_tape;
+    BumpBuffer<Node> m_tape;
 
     // Buffer for reduction inputs (to avoid reallocating in hot loops)
-    std::vector<u32> m_sum_buffer;
+    BumpBuffer<u32> m_sum_buffer;
+
+    TapeUsage m_last_usage;
 
     // Counts of global parameters
     usize m_global_param_count = 0;
@@ -32,6 +47,8 @@ private:
 
     Graph();
 
+    void propagate();
+
 public:
     inline static Graph& get() {
         thread_local Graph instance;
@@ -66,12 +83,28 @@ public:
 
     void backward();
 
+    // Backpropagate from a single output seeded with `seed`, rather than from the last operation.
+    // Gradients left over from earlier passes must be cleared first with zero_all_grads.
+    void backward(ValueHandle output, f64 seed = 1.0);
+    void backward(PairHandle output, f64x2 seed);
+
+    // Resets the tape to the global parameters. Buffers keep their memory, with some headroom over
+    // the pass just finished, so the next micro-batch records without allocating.
     void       cleanup();
     void       zero_grad();
+    void       zero_all_grads();
     void       copy_parameter_values(const Parameters& source);
     Parameters get_all_parameter_values() const;
     Parameters get_all_parameter_gradients() const;
 
+    // Adds the gradients of the global parameters to `target`, without an intermediate copy
+    void accumulate_parameter_gradients(Parameters& target) const;
+
+    // Usage of the pass ended by the last cleanup
+    const TapeUsage& last_usage() const {
+        return m_last_usage;
+    }
+
     void add_value_gradient(u32 idx, f64 delta);
     void set_value(u32 idx, f64 v);
     void zero_value_grad(u32 idx);
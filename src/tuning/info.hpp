@@ -1,8 +1,11 @@
 #pragma once
 
 #include "util/types.hpp"
+#include "util/vec/f64v.hpp"
 #include "util/vec/sse2.hpp"
+#include <algorithm>
 #include <cassert>
+#include <new>
 #include <random>
 #include <vector>
 
@@ -13,9 +16,81 @@ struct ParameterCountInfo {
     usize pair_parameter_count;
 };
 
+// A slice of the value parameters and a slice of the pair parameters
+struct ParameterRange {
+    usize value_begin;
+    usize value_end;
+    usize pair_begin;
+    usize pair_end;
+
+    static ParameterRange all(ParameterCountInfo counts) {
+        return {0, counts.parameter_count, 0, counts.pair_parameter_count};
+    }
+
+    // Shard `index` out of `count` roughly equal shards. Boundaries fall on multiples of 64 bytes,
+    // so threads working on different shards do not write to the same cache lines.
+    static ParameterRange shard(ParameterCountInfo counts, usize index, usize count) {
+        constexpr usize VALUES_PER_LINE = 64 / sizeof(f64);
+        constexpr usize PAIRS_PER_LINE  = 64 / (2 * sizeof(f64));
+
+        auto boundary = [&](usize total, usize per_line, usize i) {
+            usize lines = (total + per_line - 1) / per_line;
+            return std::min(total, lines * i / count * per_line);
+        };
+
+        return {boundary(counts.parameter_count, VALUES_PER_LINE, index),
+                boundary(counts.parameter_count, VALUES_PER_LINE, index + 1),
+                boundary(counts.pair_parameter_count, PAIRS_PER_LINE, index),
+                boundary(counts.pair_parameter_count, PAIRS_PER_LINE, index + 1)};
+    }
+};
+
+// Allocates on cache line boundaries, like the tape's BumpBuffer. Together with shard boundaries
+// on multiples of 64 bytes, this keeps threads working on different shards off each other's lines.
+template<typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+
+    static constexpr usize ALIGNMENT = 64;
+
+    CacheAlignedAllocator() = default;
+
+    template<typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {
+    }
+
+    T* allocate(usize n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ALIGNMENT}));
+    }
+
+    void deallocate(T* p, usize) {
+        ::operator delete(p, std::align_val_t{ALIGNMENT});
+    }
+
+    template<typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const {
+        return true;
+    }
+};
+
+using ValueArray = std::vector<f64, CacheAlignedAllocator<f64>>;
+using PairArray  = std::vector<f64x2, CacheAlignedAllocator<f64x2>>;
+
+static_assert(sizeof(f64x2) == 2 * sizeof(f64));
+
+// Pair arrays seen as flat arrays of doubles with mg and eg interleaved. Elementwise updates treat
+// both halves alike, so they can run over the whole array at full vector width.
+inline f64* flat_data(PairArray& pairs) {
+    return reinterpret_cast<f64*>(pairs.data());
+}
+
+inline const f64* flat_data(const PairArray& pairs) {
+    return reinterpret_cast<const f64*>(pairs.data());
+}
+
 struct Parameters {
-    std::vector<f64>   parameters;
-    std::vector<f64x2> pair_parameters;
+    ValueArray parameters;
+    PairArray  pair_parameters;
 
     static Parameters zeros(ParameterCountInfo counts) {
         Parameters result;
@@ -53,24 +128,27 @@ struct Parameters {
     void accumulate(const Parameters& b) {
         assert(b.parameters.size() == parameters.size());
         assert(b.pair_parameters.size() == pair_parameters.size());
-        for (usize i = 0; i < parameters.size(); i++) {
-            parameters[i] += b.parameters[i];
-        }
-        for (usize i = 0; i < pair_parameters.size(); i++) {
-            pair_parameters[i] = f64x2::add(pair_parameters[i], b.pair_parameters[i]);
-        }
+        add_f64(parameters.data(), b.parameters.data(), parameters.size());
+        add_f64(flat_data(pair_parameters), flat_data(b.pair_parameters),
+                2 * pair_parameters.size());
+    }
+
+    void accumulate(const Parameters& b, const ParameterRange& range) {
+        assert(b.parameters.size() == parameters.size());
+        assert(b.pair_parameters.size() == pair_parameters.size());
+        add_f64(parameters.data() + range.value_begin, b.parameters.data() + range.value_begin,
+                range.value_end - range.value_begin);
+        add_f64(flat_data(pair_parameters) + 2 * range.pair_begin,
+                flat_data(b.pair_parameters) + 2 * range.pair_begin,
+                2 * (range.pair_end - range.pair_begin));
     }
 
     void weighted_accumulate(double weight, const Parameters& b) {
         assert(b.parameters.size() == parameters.size());
         assert(b.pair_parameters.size() == pair_parameters.size());
-        for (usize i = 0; i < parameters.size(); i++) {
-            parameters[i] += weight * b.parameters[i];
-        }
-        for (usize i = 0; i < pair_parameters.size(); i++) {
-            pair_parameters[i] =
-              f64x2::madd(pair_parameters[i], f64x2::broadcast(weight), b.pair_parameters[i]);
-        }
+        madd_f64(parameters.data(), weight, b.parameters.data(), parameters.size());
+        madd_f64(flat_data(pair_parameters), weight, flat_data(b.pair_parameters),
+                 2 * pair_parameters.size());
     }
 };
 
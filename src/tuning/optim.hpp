@@ -1,23 +1,59 @@
 #pragma once
 
+#include "tuning/checkpoint.hpp"
 #include "tuning/globals.hpp"
 #include "tuning/info.hpp"
 #include "util/types.hpp"
+#include "util/vec/f64v.hpp"
 #include "util/vec/sse2.hpp"
 
 #include <cmath>
+#include <istream>
+#include <ostream>
 #include <vector>
 
 namespace Clockwork::Autograd {
 
+// Optimizer updates are elementwise, so parameters are stepped as flat arrays of doubles in blocks
+// of `WIDTH` parameters, a full f64v at a time. Blocks containing a constant parameter fall back to
+// stepping their trainable parameters one by one.
+template<usize WIDTH, typename IsConstant, typename Block, typename Single>
+inline void
+  for_each_trainable(usize begin, usize end, IsConstant is_constant, Block block, Single single) {
+    usize i = begin;
+    for (; i + WIDTH <= end; i += WIDTH) {
+        bool trainable = true;
+        for (usize j = i; j < i + WIDTH; j++) {
+            trainable &= !is_constant(j);
+        }
+        if (trainable) {
+            block(i);
+            continue;
+        }
+        for (usize j = i; j < i + WIDTH; j++) {
+            if (!is_constant(j)) {
+                single(j);
+            }
+        }
+    }
+    for (; i < end; i++) {
+        if (!is_constant(i)) {
+            single(i);
+        }
+    }
+}
+
+// Number of pair parameters per f64v, each contributing an mg and an eg lane
+inline constexpr usize PAIRS_PER_VECTOR = f64v::LANES / 2;
+
 class SGD {
 private:
     ParameterCountInfo m_counts;
     f64                m_lr;
     f64                m_momentum;
 
-    std::vector<f64>   m_value_velocity;
-    std::vector<f64x2> m_pair_velocity;
+    ValueArray m_value_velocity;
+    PairArray  m_pair_velocity;
 
 public:
     explicit SGD(ParameterCountInfo counts, f64 lr, f64 momentum = 0.9) :
@@ -28,39 +64,82 @@ public:
         m_pair_velocity.resize(m_counts.pair_parameter_count, f64x2::zero());
     }
 
+private:
+    template<typename V>
+    void update(f64* p_value, const f64* p_grad, f64* p_velocity) const {
+        const V lr_grad     = V::mul_scalar(V::load(p_grad), m_lr);
+        const V mom_v       = V::mul_scalar(V::load(p_velocity), m_momentum);
+        const V neg_lr_grad = V::neg(lr_grad);
+        const V v           = V::add(mom_v, neg_lr_grad);
+        v.store(p_velocity);
+        V::add(V::load(p_value), v).store(p_value);
+    }
+
+public:
     void step(Parameters& values, const Parameters& gradients) {
-        const auto& globals = Globals::get();
+        begin_step();
+        step(values, gradients, ParameterRange::all(m_counts));
+    }
 
-        // ---- Value parameters ----
-        for (size_t i = 0; i < m_counts.parameter_count; ++i) {
-            if (globals.is_parameter_constant(i)) {
-                continue;
-            }
+    void begin_step() {
+    }
 
-            auto& p_value = values.parameters[i];
-            auto& p_grad  = gradients.parameters[i];
-            auto& v       = m_value_velocity[i];
+    // Identifies the optimizer in checkpoints, whose state section it writes and reads
+    static constexpr u32 CHECKPOINT_ID = 1;
 
-            v = m_momentum * v - m_lr * p_grad;
-            p_value += v;
-        }
+    void save_state(std::ostream& os) const {
+        write_array(os, m_value_velocity.data(), m_value_velocity.size());
+        write_array(os, flat_data(m_pair_velocity), 2 * m_pair_velocity.size());
+    }
 
-        // ---- Pair parameters ----
-        for (size_t i = 0; i < m_counts.pair_parameter_count; ++i) {
-            if (globals.is_pair_parameter_constant(i)) {
-                continue;
-            }
+    bool load_state(std::istream& is) {
+        return read_array(is, m_value_velocity.data(), m_value_velocity.size())
+            && read_array(is, flat_data(m_pair_velocity), 2 * m_pair_velocity.size());
+    }
+
+    // Steps only the parameters in `range`. Shards of one step may run concurrently, after a
+    // single begin_step().
+    void step(Parameters& values, const Parameters& gradients, const ParameterRange& range) {
+        const auto& globals = Globals::get();
 
-            auto& p_value = values.pair_parameters[i];
-            auto& p_grad  = gradients.pair_parameters[i];
-            auto& v       = m_pair_velocity[i];
+        // ---- Value parameters ----
+        f64*       p_values   = values.parameters.data();
+        const f64* p_grads    = gradients.parameters.data();
+        f64*       p_velocity = m_value_velocity.data();
+
+        for_each_trainable<f64v::LANES>(
+          range.value_begin, range.value_end,
+          [&](usize i) {
+              return globals.is_parameter_constant(i);
+          },
+          [&](usize i) {
+              update<f64v>(p_values + i, p_grads + i, p_velocity + i);
+          },
+          [&](usize i) {
+              auto& p_value = p_values[i];
+              auto& p_grad  = p_grads[i];
+              auto& v       = p_velocity[i];
+
+              v = m_momentum * v - m_lr * p_grad;
+              p_value += v;
+          });
 
-            const f64x2 lr_grad     = f64x2::mul_scalar(p_grad, m_lr);
-            const f64x2 mom_v       = f64x2::mul_scalar(v, m_momentum);
-            const f64x2 neg_lr_grad = f64x2::neg(lr_grad);
-            v                       = f64x2::add(mom_v, neg_lr_grad);
-            p_value                 = f64x2::add(p_value, v);
-        }
+        // ---- Pair parameters ----
+        f64*       pair_values   = flat_data(values.pair_parameters);
+        const f64* pair_grads    = flat_data(gradients.pair_parameters);
+        f64*       pair_velocity = flat_data(m_pair_velocity);
+
+        for_each_trainable<PAIRS_PER_VECTOR>(
+          range.pair_begin, range.pair_end,
+          [&](usize i) {
+              return globals.is_pair_parameter_constant(i);
+          },
+          [&](usize i) {
+              update<f64v>(pair_values + 2 * i, pair_grads + 2 * i, pair_velocity + 2 * i);
+          },
+          [&](usize i) {
+              update<f64x2>(pair_values + 2 * i, pair_grads + 2 * i, pair_velocity + 2 * i);
+          });
     }
 
     void set_lr(f64 lr) {
@@ -81,11 +160,13 @@ private:
     f64                m_eps;
     f64                m_weight_decay;
     long long          m_t;
+    f64                m_inv1mb1t = 1.0;
+    f64                m_inv1mb2t = 1.0;
 
-    std::vector<f64>   m_m;
-    std::vector<f64>   m_v;
-    std::vector<f64x2> m_pair_m;
-    std::vector<f64x2> m_pair_v;
+    ValueArray m_m;
+    ValueArray m_v;
+    PairArray  m_pair_m;
+    PairArray  m_pair_v;
 
 public:
     explicit AdamW(ParameterCountInfo counts,
@@ -107,70 +188,134 @@ public:
         m_pair_v.resize(m_counts.pair_parameter_count, f64x2::zero());
     }
 
-    void step(Parameters& values, const Parameters& gradients) {
-        m_t += 1;
-        const auto& globals = Globals::get();
+private:
+    template<typename V>
+    void update(f64*       p_value,
+                const f64* p_grad,
+                f64*       p_m,
+                f64*       p_v,
+                f64        inv1mb1t,
+                f64        inv1mb2t) const {
+        const V p  = V::load(p_value);
+        const V g  = V::load(p_grad);
+        const V g2 = V::mul(g, g);
+
+        const V m_scaled = V::mul_scalar(V::load(p_m), m_beta1);
+        const V g_scaled = V::mul_scalar(g, (1.0 - m_beta1));
+        const V m        = V::add(m_scaled, g_scaled);
+
+        const V v_scaled  = V::mul_scalar(V::load(p_v), m_beta2);
+        const V g2_scaled = V::mul_scalar(g2, (1.0 - m_beta2));
+        const V v         = V::add(v_scaled, g2_scaled);
+
+        m.store(p_m);
+        v.store(p_v);
+
+        const V m_hat = V::mul_scalar(m, inv1mb1t);
+        const V v_hat = V::mul_scalar(v, inv1mb2t);
+
+        const V adam_upd  = V::div(V::mul_scalar(m_hat, m_lr),
+                                   V::add(V::sqrt(v_hat), V::broadcast(m_eps)));
+        const V decay_upd = V::mul_scalar(p, m_lr * m_weight_decay);
+        const V total_upd = V::neg(V::add(adam_upd, decay_upd));
+
+        V::add(p, total_upd).store(p_value);
+    }
 
-        const f64 b1t      = std::pow(m_beta1, static_cast<f64>(m_t));
-        const f64 b2t      = std::pow(m_beta2, static_cast<f64>(m_t));
-        const f64 inv1mb1t = 1.0 / (1.0 - b1t);
-        const f64 inv1mb2t = 1.0 / (1.0 - b2t);
+public:
+    void step(Parameters& values, const Parameters& gradients) {
+        begin_step();
+        step(values, gradients, ParameterRange::all(m_counts));
+    }
 
-        // ---------------- Value parameters ----------------
-        for (size_t i = 0; i < m_counts.parameter_count; ++i) {
-            if (globals.is_parameter_constant(i)) {
-                continue;
-            }
+    void begin_step() {
+        m_t += 1;
 
-            auto& p = values.parameters[i];
-            auto& g = gradients.parameters[i];
+        const f64 b1t = std::pow(m_beta1, static_cast<f64>(m_t));
+        const f64 b2t = std::pow(m_beta2, static_cast<f64>(m_t));
+        m_inv1mb1t    = 1.0 / (1.0 - b1t);
+        m_inv1mb2t    = 1.0 / (1.0 - b2t);
+    }
 
-            m_m[i] = m_beta1 * m_m[i] + (1.0 - m_beta1) * g;
-            m_v[i] = m_beta2 * m_v[i] + (1.0 - m_beta2) * g * g;
+    // Identifies the optimizer in checkpoints, whose state section it writes and reads
+    static constexpr u32 CHECKPOINT_ID = 2;
 
-            const f64 m_hat               = m_m[i] * inv1mb1t;
-            const f64 v_hat               = m_v[i] * inv1mb2t;
-            const f64 adam_update         = m_lr * m_hat / (std::sqrt(v_hat) + m_eps);
-            const f64 weight_decay_update = m_lr * m_weight_decay * p;
+    void save_state(std::ostream& os) const {
+        const i64 t = m_t;
+        write_array(os, &t, 1);
+        write_array(os, m_m.data(), m_m.size());
+        write_array(os, m_v.data(), m_v.size());
+        write_array(os, flat_data(m_pair_m), 2 * m_pair_m.size());
+        write_array(os, flat_data(m_pair_v), 2 * m_pair_v.size());
+    }
 
-            p += -(adam_update + weight_decay_update);
+    bool load_state(std::istream& is) {
+        i64 t = 0;
+        if (!read_array(is, &t, 1) || !read_array(is, m_m.data(), m_m.size())
+            || !read_array(is, m_v.data(), m_v.size())
+            || !read_array(is, flat_data(m_pair_m), 2 * m_pair_m.size())
+            || !read_array(is, flat_data(m_pair_v), 2 * m_pair_v.size())) {
+            return false;
         }
+        m_t = t;
+        return true;
+    }
 
-        // ---------------- Pair parameters ----------------
-        for (size_t i = 0; i < m_counts.pair_parameter_count; ++i) {
-            if (globals.is_pair_parameter_constant(i)) {
-                continue;
-            }
-
-            auto& p = values.pair_parameters[i];
-            auto& g = gradients.pair_parameters[i];
-            auto& m = m_pair_m[i];
-            auto& v = m_pair_v[i];
-
-            const f64x2 g2 = f64x2::mul(g, g);
-
-            const f64x2 m_scaled = f64x2::mul_scalar(m, m_beta1);
-            const f64x2 g_scaled = f64x2::mul_scalar(g, (1.0 - m_beta1));
-            m                    = f64x2::add(m_scaled, g_scaled);
-
-            const f64x2 v_scaled  = f64x2::mul_scalar(v, m_beta2);
-            const f64x2 g2_scaled = f64x2::mul_scalar(g2, (1.0 - m_beta2));
-            v                     = f64x2::add(v_scaled, g2_scaled);
-
-            const f64x2 m_hat = f64x2::mul_scalar(m, inv1mb1t);
-            const f64x2 v_hat = f64x2::mul_scalar(v, inv1mb2t);
-
-            const f64 adam_upd_f = m_lr * m_hat.first() / (std::sqrt(v_hat.first()) + m_eps);
-            const f64 adam_upd_s = m_lr * m_hat.second() / (std::sqrt(v_hat.second()) + m_eps);
+    // Steps only the parameters in `range`. Shards of one step may run concurrently, after a
+    // single begin_step().
+    void step(Parameters& values, const Parameters& gradients, const ParameterRange& range) {
+        const auto& globals = Globals::get();
 
-            const f64 decay_upd_f = m_lr * m_weight_decay * p.first();
-            const f64 decay_upd_s = m_lr * m_weight_decay * p.second();
+        const f64 inv1mb1t = m_inv1mb1t;
+        const f64 inv1mb2t = m_inv1mb2t;
 
-            const f64 total_upd_f = -(adam_upd_f + decay_upd_f);
-            const f64 total_upd_s = -(adam_upd_s + decay_upd_s);
+        // ---------------- Value parameters ----------------
+        f64*       p_values = values.parameters.data();
+        const f64* p_grads  = gradients.parameters.data();
+
+        for_each_trainable<f64v::LANES>(
+          range.value_begin, range.value_end,
+          [&](usize i) {
+              return globals.is_parameter_constant(i);
+          },
+          [&](usize i) {
+              update<f64v>(p_values + i, p_grads + i, m_m.data() + i, m_v.data() + i, inv1mb1t,
+                           inv1mb2t);
+          },
+          [&](usize i) {
+              auto& p = p_values[i];
+              auto& g = p_grads[i];
+
+              m_m[i] = m_m[i] * m_beta1 + g * (1.0 - m_beta1);
+              m_v[i] = m_v[i] * m_beta2 + g * g * (1.0 - m_beta2);
+
+              const f64 m_hat               = m_m[i] * inv1mb1t;
+              const f64 v_hat               = m_v[i] * inv1mb2t;
+              const f64 adam_update         = m_lr * m_hat / (std::sqrt(v_hat) + m_eps);
+              const f64 weight_decay_update = m_lr * m_weight_decay * p;
+
+              p += -(adam_update + weight_decay_update);
+          });
 
-            p = f64x2::add(p, f64x2::make(total_upd_f, total_upd_s));
-        }
+        // ---------------- Pair parameters ----------------
+        f64*       pair_values = flat_data(values.pair_parameters);
+        const f64* pair_grads  = flat_data(gradients.pair_parameters);
+        f64*       pair_m      = flat_data(m_pair_m);
+        f64*       pair_v      = flat_data(m_pair_v);
+
+        for_each_trainable<PAIRS_PER_VECTOR>(
+          range.pair_begin, range.pair_end,
+          [&](usize i) {
+              return globals.is_pair_parameter_constant(i);
+          },
+          [&](usize i) {
+              update<f64v>(pair_values + 2 * i, pair_grads + 2 * i, pair_m + 2 * i,
+                           pair_v + 2 * i, inv1mb1t, inv1mb2t);
+          },
+          [&](usize i) {
+              update<f64x2>(pair_values + 2 * i, pair_grads + 2 * i, pair_m + 2 * i,
+                            pair_v + 2 * i, inv1mb1t, inv1mb2t);
+          });
     }
 
     void set_lr(f64 lr) {
@@ -1,8 +1,11 @@
 #include "uci.hpp"
+#include "analyze.hpp"
 #include "bench.hpp"
+#include "datagen.hpp"
 #include "evaluation.hpp"
+#include "genfens.hpp"
 #include "move.hpp"
-#include "movepick.hpp"
+#include "numa.hpp"
 #include "perft.hpp"
 #include "position.hpp"
 #include "search.hpp"
@@ -10,29 +13,51 @@
 #include "tuned.hpp"
 #include "util/ios_fmt_guard.hpp"
 #include "util/parse.hpp"
-#include "util/random.hpp"
 #include "util/version.hpp"
 #include <algorithm>
 #include <fstream>
 #include <ios>
 #include <iostream>
 #include <istream>
+#include <span>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_set>
 
 namespace Clockwork::UCI {
 
 
 constexpr std::string_view STARTPOS{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
-constexpr usize            MAX_HASH    = 268435456;
-constexpr usize            MAX_THREADS = 1024;
+constexpr usize            MAX_HASH      = 268435456;
+constexpr usize            MAX_EVAL_HASH = 65536;
+constexpr usize            MAX_THREADS   = 1024;
 
 UCIHandler::UCIHandler() :
     m_position(*Position::parse(STARTPOS)) {
     searcher.initialize(1);
     searcher.set_position(m_position, m_repetition_info);
+    print_page_usage();
+}
+
+static void print_region_usage(std::string_view name, std::span<const MemoryRegion> regions) {
+    auto usage = page_usage(regions);
+    if (!usage || usage->resident_bytes == 0) {
+        return;
+    }
+
+    usize percent = usage->huge_bytes * 100 / usage->resident_bytes;
+    std::cout << "info string " << name << ": " << usage->resident_bytes / 1024 << " KiB resident, "
+              << percent << "% on " << (usage->hugetlb ? "explicit" : "transparent")
+              << " huge pages" << std::endl;
+}
+
+// Hosts with THP disabled or no reserved huge pages silently cost us TLB misses, so say so.
+void UCIHandler::print_page_usage() {
+    MemoryRegion tt = searcher.tt.memory();
+    print_region_usage("Hash", {&tt, 1});
+    print_region_usage("Workers", searcher.worker_memory());
 }
 
 void UCIHandler::loop() {
@@ -63,6 +88,11 @@ void UCIHandler::execute_command(const std::string& line) {
         std::cout << "option name UseSoftNodes type check default false\n";
         std::cout << "option name Threads type spin default 1 min 1 max " << MAX_THREADS << "\n";
         std::cout << "option name Hash type spin default 16 min 1 max " << MAX_HASH << "\n";
+        std::cout << "option name EvalHash type spin default " << EvalCache::DEFAULT_SIZE_MB
+                  << " min 0 max " << MAX_EVAL_HASH << "\n";
+        std::cout << "option name NumaAware type check default false\n";
+        std::cout << "option name ThreadBinding type string default none\n";
+        std::cout << "option name LazyEval type check default false\n";
         tuned::uci_print_tunable_options();
         std::cout << "uciok" << std::endl;
     } else if (command == "ucinewgame") {
@@ -96,8 +126,14 @@ void UCIHandler::execute_command(const std::string& line) {
         handle_bench(is);
     } else if (command == "speedtest") {
         handle_speedtest(is);
+    } else if (command == "hashsweep") {
+        handle_hashsweep(is);
     } else if (command == "debug") {
         handle_debug(is);
+    } else if (command == "savehash") {
+        handle_savehash(is);
+    } else if (command == "loadhash") {
+        handle_loadhash(is);
     }
 #ifndef EVAL_TUNING
     else if (command == "eval") {
@@ -106,6 +142,10 @@ void UCIHandler::execute_command(const std::string& line) {
 #endif
     else if (command == "genfens") {
         handle_genfens(is);
+    } else if (command == "analyze") {
+        handle_analyze(is);
+    } else if (command == "datagen") {
+        handle_datagen(is);
     } else {
         std::cout << "Unknown command" << std::endl;
     }
@@ -121,6 +161,21 @@ void UCIHandler::handle_bench(std::istringstream& is) {
     Bench::benchmark(searcher, depth);
 }
 
+void UCIHandler::handle_hashsweep(std::istringstream& is) {
+    Depth depth = 12;
+    if (!(is >> depth)) {
+        is.clear();
+        depth = 12;
+    }
+    std::vector<usize> sizes_mb;
+    usize              mb;
+    while (is >> mb) {
+        sizes_mb.push_back(std::clamp<usize>(mb, 1, MAX_HASH));
+    }
+    Bench::hash_sweep(searcher, depth, sizes_mb);
+    searcher.set_position(m_position, m_repetition_info);
+}
+
 // Note: This function is left here so that one doesn't need to reimplement it every time we need to expose a function through uci.
 // The professional thing to do is to empty the body of the function / put a placeholder in here when finished (and before pr).
 void UCIHandler::handle_debug(std::istringstream&) {
@@ -257,6 +312,14 @@ void UCIHandler::handle_setoption(std::istringstream& is) {
         if (auto value = parse_number<usize>(value_str)) {
             usize hash_size = std::clamp<usize>(*value, 1, MAX_HASH);
             searcher.resize_tt(hash_size);
+            print_page_usage();
+        } else {
+            std::cout << "Invalid value " << value_str << std::endl;
+        }
+    } else if (name == "EvalHash") {
+        if (auto value = parse_number<usize>(value_str)) {
+            usize eval_hash_size = std::clamp<usize>(*value, 0, MAX_EVAL_HASH);
+            searcher.resize_eval_cache(eval_hash_size);
         } else {
             std::cout << "Invalid value " << value_str << std::endl;
         }
@@ -268,6 +331,33 @@ void UCIHandler::handle_setoption(std::istringstream& is) {
         } else {
             std::cout << "Invalid value " << value_str << std::endl;
         }
+    } else if (name == "NumaAware") {
+        if (value_str == "true" || value_str == "false") {
+            bool numa_aware = value_str == "true";
+            searcher.set_numa_aware(numa_aware);
+            searcher.set_position(m_position, m_repetition_info);
+            if (numa_aware) {
+                std::cout << "info string Using " << Numa::topology().node_count()
+                          << " NUMA node(s)" << std::endl;
+            }
+        } else {
+            std::cout << "Invalid value " << value_str << std::endl;
+        }
+    } else if (name == "ThreadBinding") {
+        if (auto binding = Numa::ThreadBinding::parse(value_str)) {
+            searcher.set_thread_binding(*binding);
+            searcher.set_position(m_position, m_repetition_info);
+        } else {
+            std::cout << "Invalid value " << value_str << std::endl;
+        }
+    } else if (name == "LazyEval") {
+        if (value_str == "true") {
+            searcher.set_lazy_eval(true);
+        } else if (value_str == "false") {
+            searcher.set_lazy_eval(false);
+        } else {
+            std::cout << "Invalid value " << value_str << std::endl;
+        }
     } else if (name == "UseSoftNodes") {
         if (value_str == "true") {
             m_use_soft_nodes = true;
@@ -301,34 +391,181 @@ void UCIHandler::handle_attacks(std::istringstream&) {
 }
 
 void UCIHandler::handle_perft(std::istringstream& is) {
-    std::string token;
-    i32         depth = 1;
+    std::string  token;
+    i32          depth = 1;
+    PerftOptions options;
 
     if (is >> token) {
         depth = std::stoi(token);
         depth = std::max(0, depth);
     }
 
-    split_perft(m_position, static_cast<usize>(depth));
+    while (is >> token) {
+        if (token == "threads") {
+            if (!(is >> options.threads) || options.threads == 0) {
+                std::cout << "Invalid threads value." << std::endl;
+                return;
+            }
+            options.threads = std::min(options.threads, MAX_THREADS);
+        } else if (token == "hash") {
+            if (!(is >> options.hash_mb)) {
+                std::cout << "Invalid hash value." << std::endl;
+                return;
+            }
+            options.hash_mb = std::min(options.hash_mb, MAX_HASH);
+        } else {
+            std::cout << "Invalid perft argument: " << token << std::endl;
+            return;
+        }
+    }
+
+    split_perft(m_position, static_cast<usize>(depth), options);
+}
+
+void UCIHandler::handle_savehash(std::istringstream& is) {
+    std::string path;
+    if (!(is >> path)) {
+        std::cout << "Missing filename after 'savehash'." << std::endl;
+        return;
+    }
+
+    searcher.wait();
+    auto         start  = time::Clock::now();
+    TTFileStatus status = searcher.tt.save(path);
+    if (status != TTFileStatus::Ok) {
+        std::cout << "info string Failed to save hash to " << path << ": " << to_string(status)
+                  << std::endl;
+        return;
+    }
+    std::cout << "info string Saved " << searcher.tt.size_bytes() / (1024 * 1024) << " MB hash to "
+              << path << " in "
+              << time::cast<time::Milliseconds>(time::Clock::now() - start).count() << " ms"
+              << std::endl;
+}
+
+void UCIHandler::handle_loadhash(std::istringstream& is) {
+    std::string path, token;
+    if (!(is >> path)) {
+        std::cout << "Missing filename after 'loadhash'." << std::endl;
+        return;
+    }
+    bool map = false;
+    while (is >> token) {
+        if (token == "mmap") {
+            map = true;
+        } else {
+            std::cout << "Invalid loadhash argument: " << token << std::endl;
+            return;
+        }
+    }
+
+    searcher.wait();
+    auto         start  = time::Clock::now();
+    TTFileStatus status = searcher.tt.load(path, map);
+    if (status != TTFileStatus::Ok) {
+        std::cout << "info string Failed to load hash from " << path << ": " << to_string(status)
+                  << std::endl;
+        return;
+    }
+    std::cout << "info string Loaded " << searcher.tt.size_bytes() / (1024 * 1024)
+              << " MB hash from " << path << (map ? " (mapped)" : "") << " in "
+              << time::cast<time::Milliseconds>(time::Clock::now() - start).count() << " ms"
+              << std::endl;
+}
+
+static bool load_book(const std::string& book, std::vector<std::string>& lines) {
+    std::cout << "Using book file: " << book << std::endl;
+
+    // Open the book file
+    std::ifstream file(book);
+    if (!file) {
+        std::cout << "Could not open file: " << book << std::endl;
+        return false;
+    }
+
+    // Load all lines
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+
+    if (lines.empty()) {
+        std::cout << "Book file is empty." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void UCIHandler::handle_analyze(std::istringstream& is) {
+    Analyze::AnalyzeOptions options;
+    std::string             path, token;
+
+    if (!(is >> path)) {
+        std::cout << "Missing FEN file after 'analyze'." << std::endl;
+        return;
+    }
+
+    while (is >> token) {
+        if (token == "nodes") {
+            if (!(is >> options.nodes)) {
+                std::cout << "Invalid nodes value." << std::endl;
+                return;
+            }
+        } else if (token == "depth") {
+            if (!(is >> options.depth) || options.depth < 0) {
+                std::cout << "Invalid depth value." << std::endl;
+                return;
+            }
+        } else if (token == "threads") {
+            if (!(is >> options.threads) || options.threads == 0) {
+                std::cout << "Invalid threads value." << std::endl;
+                return;
+            }
+            options.threads = std::min(options.threads, MAX_THREADS);
+        } else if (token == "hash") {
+            if (!(is >> options.hash_mb) || options.hash_mb == 0) {
+                std::cout << "Invalid hash value." << std::endl;
+                return;
+            }
+            options.hash_mb = std::min(options.hash_mb, MAX_HASH);
+        } else if (token == "out") {
+            if (!(is >> options.output)) {
+                std::cout << "Missing filename after 'out'." << std::endl;
+                return;
+            }
+        } else {
+            std::cout << "Invalid analyze argument: " << token << std::endl;
+            return;
+        }
+    }
+
+    if (options.nodes == 0 && options.depth == 0) {
+        std::cout << "Either nodes or depth is required." << std::endl;
+        return;
+    }
+
+    Analyze::analyze(path, options);
 }
 
 void UCIHandler::handle_genfens(std::istringstream& is) {
-    i32         N             = 0;
-    uint64_t    seed          = 0;
-    bool        seed_provided = false;
-    i32         rand_count    = 4;
-    std::string book          = "None";
-    std::string token;
+    Genfens::GenfensOptions options;
+    i32                     N             = 0;
+    bool                    seed_provided = false;
+    std::string             book          = "None";
+    std::string             token;
 
     // Parse arguments
     if (!(is >> N) || N <= 0) {
         std::cout << "Invalid or missing number of positions (N)." << std::endl;
         return;
     }
+    options.count = static_cast<usize>(N);
 
     while (is >> token) {
         if (token == "seed") {
-            if (!(is >> seed)) {
+            if (!(is >> options.seed)) {
                 std::cout << "Invalid seed value." << std::endl;
                 return;
             }
@@ -339,108 +576,98 @@ void UCIHandler::handle_genfens(std::istringstream& is) {
                 return;
             }
         } else if (token == "randmoves") {
-            if (!(is >> rand_count) || rand_count < 0) {
+            if (!(is >> options.rand_moves) || options.rand_moves < 0) {
                 std::cout << "Invalid randmoves value." << std::endl;
                 return;
             }
+        } else if (token == "threads") {
+            if (!(is >> options.threads) || options.threads == 0) {
+                std::cout << "Invalid threads value." << std::endl;
+                return;
+            }
+            options.threads = std::min(options.threads, MAX_THREADS);
         } else {
             std::cout << "Invalid genfens argument: " << token << std::endl;
             return;
         }
     }
 
-    // Set RNG state
     if (!seed_provided) {
         std::cout << "Seed not provided. Defaulting to 0." << std::endl;
     }
-    Clockwork::Random::seed({seed, seed, seed | 1, seed ^ 0xDEADBEEFDEADBEEFULL});
-
-    std::vector<std::string> lines;
-    std::string              line;
-    if (book != "None") {
-        std::cout << "Using book file: " << book << std::endl;
-
-        // Open the book file
-        std::ifstream file(book);
-        if (!file) {
-            std::cout << "Could not open file: " << book << std::endl;
-            return;
-        }
-
-        // Load all lines
-        while (std::getline(file, line)) {
-            if (!line.empty()) {
-                lines.push_back(line);
-            }
-        }
 
-        if (lines.empty()) {
-            std::cout << "Book file is empty." << std::endl;
-            return;
-        }
-        file.close();
-    } else {
-        // Add startpositions to lines
-        lines.push_back("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
-    }
-
-    // Line generation is as follows:
-    // 1) Pick a random line from the book (or startposition if no book)
-    // 2) Play random legal moves (see passing noisy or quiet moves)
-    // Launch a 16k softnodes verification search to make sure the position doesn't lose immediately
-    // 3) If the position is legal, print it
-    i32 generated = 0;
-
-    while (generated < N) {
-reset:
-        // Pick a random line from the book
-        const std::string& selected_line = lines[Clockwork::Random::rand_64() % lines.size()];
-
-        // Set up position
-        Position pos = *Position::parse(selected_line);
-
-        i32 moves = 0;
-        // Make 4 random moves out of book
-        while (moves < rand_count) {
-            RandomMovePicker picker(pos);
-            Move             m = picker.next();
-            if (m == Move::none()) {
-                // No moves available, skip
-                goto reset;
-            }
-            pos = pos.move(m);
-            moves++;
-        }
-
-        // Mock search limits for datagen verification
-        Search::SearchSettings settings = {
-          .stm = pos.active_color(), .hard_nodes = 1048576, .soft_nodes = 16384, .silent = true};
+    if (book != "None" && !load_book(book, options.book)) {
+        return;
+    }
 
-        searcher.initialize(1);  // Initialize with 1 thread always for datagen
+    Genfens::genfens(options);
+}
 
-        RepetitionInfo rep_info;
-        rep_info.reset();
-        rep_info.push(pos.get_hash_key(), false);
+void UCIHandler::handle_datagen(std::istringstream& is) {
+    Datagen::DatagenOptions options;
+    std::string             book = "None";
+    std::string             token;
 
-        searcher.set_position(pos, rep_info);
-        searcher.launch_search(settings);
+    options.threads = std::clamp<usize>(std::thread::hardware_concurrency(), 1, MAX_THREADS);
 
-        // Wait for the search to finish and get the score
-        Value score = searcher.wait_for_score();
+    if (!(is >> options.output)) {
+        std::cout << "Missing output filename after 'datagen'." << std::endl;
+        return;
+    }
 
-        if (std::abs(score) > 450) {
-            // Position is mate or losing, skip
-            goto reset;
+    while (is >> token) {
+        if (token == "games") {
+            if (!(is >> options.games)) {
+                std::cout << "Invalid games value." << std::endl;
+                return;
+            }
+        } else if (token == "nodes") {
+            if (!(is >> options.nodes) || options.nodes == 0) {
+                std::cout << "Invalid nodes value." << std::endl;
+                return;
+            }
+        } else if (token == "threads") {
+            if (!(is >> options.threads) || options.threads == 0) {
+                std::cout << "Invalid threads value." << std::endl;
+                return;
+            }
+            options.threads = std::min(options.threads, MAX_THREADS);
+        } else if (token == "seed") {
+            if (!(is >> options.seed)) {
+                std::cout << "Invalid seed value." << std::endl;
+                return;
+            }
+        } else if (token == "book") {
+            if (!(is >> book)) {
+                std::cout << "Missing book filename after 'book'." << std::endl;
+                return;
+            }
+        } else if (token == "randmoves") {
+            if (!(is >> options.rand_moves) || options.rand_moves < 0) {
+                std::cout << "Invalid randmoves value." << std::endl;
+                return;
+            }
+        } else {
+            std::cout << "Invalid datagen argument: " << token << std::endl;
+            return;
         }
+    }
 
-        // If we reach here, the position is legal
-        std::cout << "info string genfens " << pos << std::endl;
-        generated++;
+    if (options.games == 0) {
+        std::cout << "Number of games is required." << std::endl;
+        return;
     }
+
+    if (book != "None" && !load_book(book, options.book)) {
+        return;
+    }
+
+    Datagen::datagen(options);
 }
 
 void UCIHandler::handle_speedtest(std::istringstream&) {
     Speedtest::speedtest(searcher);
+    searcher.set_position(m_position, m_repetition_info);
 }
 
 }  // namespace Clockwork::UCI
@@ -38,9 +38,16 @@ private:
     void handle_attacks(std::istringstream&);
     void handle_perft(std::istringstream&);
     void handle_speedtest(std::istringstream&);
+    void handle_hashsweep(std::istringstream&);
+    void handle_savehash(std::istringstream&);
+    void handle_loadhash(std::istringstream&);
 
     void handle_genfens(std::istringstream&);
+    void handle_analyze(std::istringstream&);
+    void handle_datagen(std::istringstream&);
     void handle_debug(std::istringstream&);
+
+    void print_page_usage();
 };
 
 }  // namespace Clockwork::UCI
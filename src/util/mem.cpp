@@ -0,0 +1,114 @@
+#include "util/mem.hpp"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#ifdef __linux__
+namespace {
+
+struct Mapping {
+    std::uintptr_t start        = 0;
+    std::uintptr_t end          = 0;
+    std::size_t    rss_kb       = 0;
+    std::size_t    anon_huge_kb = 0;
+    std::size_t    hugetlb_kb   = 0;
+    bool           valid        = false;
+};
+
+// Parses a mapping header such as "7f0000000000-7f0000200000 rw-p 00000000 00:00 0".
+bool parse_range(std::string_view line, Mapping& mapping) {
+    std::size_t dash  = line.find('-');
+    std::size_t space = line.find(' ');
+    if (dash == std::string_view::npos || space == std::string_view::npos || dash > space) {
+        return false;
+    }
+    auto start = std::from_chars(line.data(), line.data() + dash, mapping.start, 16);
+    auto end   = std::from_chars(line.data() + dash + 1, line.data() + space, mapping.end, 16);
+    return start.ec == std::errc{} && end.ec == std::errc{} && mapping.start < mapping.end;
+}
+
+// Parses a field such as "AnonHugePages:      2048 kB".
+std::size_t parse_kb(std::string_view line) {
+    std::size_t colon = line.find(':');
+    std::size_t value = 0;
+    if (colon != std::string_view::npos) {
+        std::string_view rest  = line.substr(colon + 1);
+        std::size_t      digit = rest.find_first_not_of(' ');
+        if (digit != std::string_view::npos) {
+            std::from_chars(rest.data() + digit, rest.data() + rest.size(), value);
+        }
+    }
+    return value;
+}
+
+// Adds the share of a mapping that overlaps a region to `usage`.
+void accumulate(const Mapping& mapping, const MemoryRegion& region, PageUsage& usage) {
+    auto           begin = reinterpret_cast<std::uintptr_t>(region.ptr);
+    std::uintptr_t lo    = std::max(begin, mapping.start);
+    std::uintptr_t hi    = std::min(begin + region.bytes, mapping.end);
+    if (!mapping.valid || region.ptr == nullptr || lo >= hi) {
+        return;
+    }
+
+    // smaps only has totals per mapping, so assume they are spread evenly over it
+    double share = static_cast<double>(hi - lo) / static_cast<double>(mapping.end - mapping.start);
+    auto   scale = [share](std::size_t kb) {
+        return static_cast<std::size_t>(static_cast<double>(kb * 1024) * share);
+    };
+
+    if (mapping.hugetlb_kb > 0) {
+        usage.resident_bytes += scale(mapping.hugetlb_kb);
+        usage.huge_bytes += scale(mapping.hugetlb_kb);
+        usage.hugetlb = true;
+    } else {
+        usage.resident_bytes += scale(mapping.rss_kb);
+        usage.huge_bytes += scale(mapping.anon_huge_kb);
+    }
+}
+
+}  // namespace
+#endif
+
+std::optional<PageUsage> page_usage(std::span<const MemoryRegion> regions) {
+#ifdef __linux__
+    std::ifstream smaps{"/proc/self/smaps"};
+    if (!smaps) {
+        return std::nullopt;
+    }
+
+    PageUsage usage;
+    Mapping   mapping;
+
+    auto flush = [&] {
+        for (const MemoryRegion& region : regions) {
+            accumulate(mapping, region, usage);
+        }
+    };
+
+    std::string line;
+    while (std::getline(smaps, line)) {
+        std::string_view view{line};
+
+        Mapping next;
+        if (parse_range(view, next)) {
+            flush();
+            mapping       = next;
+            mapping.valid = true;
+        } else if (view.starts_with("Rss:")) {
+            mapping.rss_kb = parse_kb(view);
+        } else if (view.starts_with("AnonHugePages:")) {
+            mapping.anon_huge_kb = parse_kb(view);
+        } else if (view.starts_with("Private_Hugetlb:") || view.starts_with("Shared_Hugetlb:")) {
+            mapping.hugetlb_kb += parse_kb(view);
+        }
+    }
+    flush();
+
+    return usage;
+#else
+    (void)regions;
+    return std::nullopt;
+#endif
+}
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <type_traits>
 
 #ifdef __linux__
@@ -21,17 +24,52 @@ using unique_ptr_huge_page =
                      std::unique_ptr<T, std::function<void(std::remove_all_extents_t<T>*)>>,
                      std::unique_ptr<T, std::function<void(T*)>>>;
 
-template<typename T>
-T* allocate_huge_page(std::size_t size) {
-    constexpr static auto huge_page_size = 2 * 1024 * 1024;  // 2MB pages
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;  // 2MB pages
+
+inline std::size_t round_to_huge_pages(std::size_t size) {
+    return ((size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+}
 
 #ifdef __linux__
-    size    = ((size + huge_page_size - 1) / huge_page_size) * huge_page_size;
-    T* data = static_cast<T*>(std::aligned_alloc(huge_page_size, size));
-    if (data) {
-        madvise(data, size, MADV_HUGEPAGE);
+// Explicit huge pages first, which only works if some have been reserved (vm.nr_hugepages). Then a
+// huge page aligned mapping that the kernel may back with transparent huge pages, and which ends
+// up on normal pages when THP is disabled. `size` must be a multiple of HUGE_PAGE_SIZE.
+inline void* map_huge_pages(std::size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+        return data;
     }
+
+    // Over-allocate, then trim the mapping down to a huge page boundary
+    std::size_t padded = size + HUGE_PAGE_SIZE;
+    void*       raw =
+      mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    auto        address = reinterpret_cast<std::uintptr_t>(raw);
+    auto        aligned = (address + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    std::size_t head    = aligned - address;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    munmap(reinterpret_cast<void*>(aligned + size), padded - head - size);
+
+    data = reinterpret_cast<void*>(aligned);
+    madvise(data, size, MADV_HUGEPAGE);
     return data;
+}
+#endif
+
+template<typename T>
+T* allocate_huge_page(std::size_t size) {
+#ifdef __linux__
+    return static_cast<T*>(map_huge_pages(round_to_huge_pages(size)));
 #elif defined(_WIN32)
     HANDLE           hToken;
     TOKEN_PRIVILEGES tp;
@@ -86,16 +124,17 @@ T* allocate_huge_page(std::size_t size) {
     return data;
 #else
     // Fallback for other platforms
-    size    = ((size + huge_page_size - 1) / huge_page_size) * huge_page_size;
-    T* data = static_cast<T*>(std::aligned_alloc(huge_page_size, size));
-    return data;
+    return static_cast<T*>(std::aligned_alloc(HUGE_PAGE_SIZE, round_to_huge_pages(size)));
 #endif
 }
 
+// `size` must be the size that was passed to allocate_huge_page.
 template<typename T>
-void deallocate_huge_page(T* ptr) {
+void deallocate_huge_page(T* ptr, [[maybe_unused]] std::size_t size) {
 #ifdef __linux__
-    std::free(ptr);
+    if (ptr != nullptr) {
+        munmap(static_cast<void*>(ptr), round_to_huge_pages(size));
+    }
 #elif defined(_WIN32)
     VirtualFree(ptr, 0, MEM_RELEASE);
 #else
@@ -110,7 +149,7 @@ unique_ptr_huge_page<T> make_unique_huge_page(Args&&... args) {
     std::construct_at(data, std::forward<Args>(args)...);
     return unique_ptr_huge_page<T>(data, [](T* ptr) {
         std::destroy_at(ptr);
-        deallocate_huge_page(ptr);
+        deallocate_huge_page(ptr, sizeof(T));
     });
 }
 
@@ -122,7 +161,7 @@ unique_ptr_huge_page<T> make_unique_huge_page(std::size_t n) {
     std::uninitialized_value_construct_n(data, n);
     return unique_ptr_huge_page<T>(data, [n](E* ptr) {
         std::destroy_n(ptr, n);
-        deallocate_huge_page(ptr);
+        deallocate_huge_page(ptr, n * sizeof(E));
     });
 }
 
@@ -137,7 +176,7 @@ unique_ptr_huge_page<T> make_unique_for_overwrite_huge_page() {
     new (data) T;
     return unique_ptr_huge_page<T>(data, [](T* ptr) {
         std::destroy_at(ptr);
-        deallocate_huge_page(ptr);
+        deallocate_huge_page(ptr, sizeof(T));
     });
 }
 
@@ -149,7 +188,7 @@ unique_ptr_huge_page<T> make_unique_for_overwrite_huge_page(std::size_t n) {
     std::uninitialized_default_construct_n(data, n);
     return unique_ptr_huge_page<T>(data, [n](E* ptr) {
         std::destroy_n(ptr, n);
-        deallocate_huge_page(ptr);
+        deallocate_huge_page(ptr, n * sizeof(E));
     });
 }
 
@@ -165,6 +204,21 @@ void advise_huge_pages(T* ptr, std::size_t size_bytes) {
 #endif
 }
 
+struct MemoryRegion {
+    const void* ptr;
+    std::size_t bytes;
+};
+
+struct PageUsage {
+    std::size_t resident_bytes = 0;
+    std::size_t huge_bytes     = 0;
+    bool        hugetlb        = false;  // Explicit huge pages rather than transparent ones
+};
+
+// How much of some memory regions is resident and how much of that is backed by huge pages,
+// according to /proc/self/smaps. Returns nothing where that is not available.
+std::optional<PageUsage> page_usage(std::span<const MemoryRegion> regions);
+
 // Prefetching utilities
 inline void prefetch(const void* ptr) {
     __builtin_prefetch(ptr);
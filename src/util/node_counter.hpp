@@ -0,0 +1,45 @@
+#pragma once
+
+#include "util/types.hpp"
+#include <atomic>
+
+namespace Clockwork {
+
+// Node counter owned by a single search thread.
+// Counting is a plain increment. The total is published to an atomic on its own cache line every
+// PUBLISH_INTERVAL nodes (and on request), so threads polling it never slow down the owner.
+class alignas(64) NodeCounter {
+public:
+    static constexpr u64 PUBLISH_INTERVAL = 1024;
+
+    void reset() {
+        m_local = 0;
+        m_published.store(0, std::memory_order_relaxed);
+    }
+
+    void increment() {
+        if (++m_local % PUBLISH_INTERVAL == 0) {
+            publish();
+        }
+    }
+
+    void publish() {
+        m_published.store(m_local, std::memory_order_relaxed);
+    }
+
+    // Exact count, only to be read by the owning thread.
+    [[nodiscard]] u64 local() const {
+        return m_local;
+    }
+
+    // Safe to read from any thread, lags behind by less than PUBLISH_INTERVAL nodes.
+    [[nodiscard]] u64 published() const {
+        return m_published.load(std::memory_order_relaxed);
+    }
+
+private:
+    u64                          m_local = 0;
+    alignas(64) std::atomic<u64> m_published{0};
+};
+
+}  // namespace Clockwork
@@ -36,9 +36,6 @@ public:
     };
 
 
-    static inline u128 state     = 0;
-    static inline u128 increment = 0;
-
     // Multiplier constant from PCG paper
     static constexpr u128 MULT = (u128)0x2360ED051FC65DA4ULL << 64 | (u128)0x4385DF649FCCF645ULL;
 
@@ -46,17 +43,23 @@ public:
     static constexpr u256 FIXED_SEED{0x5132397362474669ULL, 0x62334a6864476c32ULL,
                                      0x5a53424951305567ULL, 0x5257356e6157356cULL};
 
-    struct Init {
-        Init() {
-            Random::seed(FIXED_SEED);
-        }
-    };
-    static inline Init _auto_init;
+    static constexpr u128 seeded_increment(const u256& s) {
+        return s.high128() | 1;  // must be odd for LCG
+    }
+
+    static constexpr u128 seeded_state(const u256& s) {
+        u128 inc = seeded_increment(s);
+        return (s.low128() + inc) * MULT + inc;
+    }
+
+    // The generator state is per thread, so threads seeded differently draw independent streams.
+    // Every thread starts out seeded with FIXED_SEED.
+    static inline thread_local u128 increment = seeded_increment(FIXED_SEED);
+    static inline thread_local u128 state     = seeded_state(FIXED_SEED);
 
     static void seed(const u256& s) {
-        u128 state_ = s.low128();
-        u128 incr_  = s.high128() | 1;  // must be odd for LCG
-        from_state_incr(state_, incr_);
+        increment = seeded_increment(s);
+        state     = seeded_state(s);
     }
 
     static u64 rand_64() {
@@ -85,13 +88,6 @@ public:
     }
 
 private:
-    static void from_state_incr(u128 st, u128 inc) {
-        state     = st;
-        increment = inc;
-        state += increment;
-        step();
-    }
-
     // LCG step
     static inline void step() {
         state = state * MULT + increment;
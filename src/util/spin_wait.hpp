@@ -0,0 +1,51 @@
+#pragma once
+
+#include "util/types.hpp"
+#include <atomic>
+#include <thread>
+
+namespace Clockwork {
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Waits until `done(value)` holds for the value of `atom`.
+// The waiter spins for a short while first, so work that arrives right away is picked up without
+// a syscall, and then blocks in std::atomic::wait (a futex on Linux). Whoever changes `atom` must
+// call notify_one/notify_all on it afterwards.
+template<typename T, typename Pred>
+T spin_then_wait(const std::atomic<T>& atom, Pred done) {
+    constexpr usize SPIN_ITERATIONS  = 1 << 12;
+    constexpr usize YIELD_ITERATIONS = 16;
+
+    for (usize i = 0; i < SPIN_ITERATIONS; i++) {
+        T value = atom.load(std::memory_order_acquire);
+        if (done(value)) {
+            return value;
+        }
+        cpu_relax();
+    }
+
+    // Give oversubscribed cores a chance to run whoever we are waiting for
+    for (usize i = 0; i < YIELD_ITERATIONS; i++) {
+        T value = atom.load(std::memory_order_acquire);
+        if (done(value)) {
+            return value;
+        }
+        std::this_thread::yield();
+    }
+
+    T value = atom.load(std::memory_order_acquire);
+    while (!done(value)) {
+        atom.wait(value, std::memory_order_acquire);
+        value = atom.load(std::memory_order_acquire);
+    }
+    return value;
+}
+
+}  // namespace Clockwork
@@ -0,0 +1,156 @@
+#pragma once
+#include "util/vec/sse2.hpp"
+
+#include <cstddef>
+#include <ostream>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define F64X4_USE_AVX2 1
+#else
+    #define F64X4_USE_AVX2 0
+#endif
+
+// Four doubles. Without AVX2 this is a pair of f64x2, so code written against it still builds.
+struct f64x4 {
+    static constexpr std::size_t LANES = 4;
+
+#if F64X4_USE_AVX2
+    __m256d v = _mm256_setzero_pd();
+#else
+    f64x2 lo;
+    f64x2 hi;
+#endif
+
+    // ---- Constructors ----
+    static inline f64x4 broadcast(double x) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_set1_pd(x);
+        return r;
+#else
+        return {f64x2::broadcast(x), f64x2::broadcast(x)};
+#endif
+    }
+
+    static inline f64x4 zero() {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_setzero_pd();
+        return r;
+#else
+        return {f64x2::zero(), f64x2::zero()};
+#endif
+    }
+
+    // ---- Memory (unaligned) ----
+    static inline f64x4 load(const double* p) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_loadu_pd(p);
+        return r;
+#else
+        return {f64x2::load(p), f64x2::load(p + 2)};
+#endif
+    }
+
+    inline void store(double* p) const {
+#if F64X4_USE_AVX2
+        _mm256_storeu_pd(p, v);
+#else
+        lo.store(p);
+        hi.store(p + 2);
+#endif
+    }
+
+    // ---- Arithmetic ----
+    static inline f64x4 add(const f64x4& a, const f64x4& b) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_add_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x2::add(a.lo, b.lo), f64x2::add(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x4 sub(const f64x4& a, const f64x4& b) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_sub_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x2::sub(a.lo, b.lo), f64x2::sub(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x4 mul(const f64x4& a, const f64x4& b) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_mul_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x2::mul(a.lo, b.lo), f64x2::mul(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x4 div(const f64x4& a, const f64x4& b) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_div_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x2::div(a.lo, b.lo), f64x2::div(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x4 neg(const f64x4& a) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_sub_pd(_mm256_setzero_pd(), a.v);
+        return r;
+#else
+        return {f64x2::neg(a.lo), f64x2::neg(a.hi)};
+#endif
+    }
+
+    // ---- Scalar ops ----
+    static inline f64x4 mul_scalar(const f64x4& a, double s) {
+        return mul(a, broadcast(s));
+    }
+
+    static inline f64x4 div_scalar(const f64x4& a, double s) {
+        return div(a, broadcast(s));
+    }
+
+    // ---- Math functions ----
+    static inline f64x4 sqrt(const f64x4& a) {
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_sqrt_pd(a.v);
+        return r;
+#else
+        return {f64x2::sqrt(a.lo), f64x2::sqrt(a.hi)};
+#endif
+    }
+
+    // ---- FMA-style ----
+    static inline f64x4 madd(const f64x4& a, const f64x4& b, const f64x4& c) {
+        // a + b*c, rounded twice like f64x2::madd
+#if F64X4_USE_AVX2
+        f64x4 r;
+        r.v = _mm256_add_pd(a.v, _mm256_mul_pd(b.v, c.v));
+        return r;
+#else
+        return {f64x2::madd(a.lo, b.lo, c.lo), f64x2::madd(a.hi, b.hi, c.hi)};
+#endif
+    }
+
+    // ---- Printing ----
+    friend std::ostream& operator<<(std::ostream& os, const f64x4& f) {
+        alignas(32) double buf[LANES];
+        f.store(buf);
+        os << "(" << buf[0] << ", " << buf[1] << ", " << buf[2] << ", " << buf[3] << ")";
+        return os;
+    }
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include "util/vec/avx2.hpp"
+
+#include <cstddef>
+#include <ostream>
+
+#if defined(__AVX512F__)
+    #include <immintrin.h>
+    #define F64X8_USE_AVX512 1
+#else
+    #define F64X8_USE_AVX512 0
+#endif
+
+// Eight doubles. Without AVX-512 this is a pair of f64x4, so code written against it still builds.
+struct f64x8 {
+    static constexpr std::size_t LANES = 8;
+
+#if F64X8_USE_AVX512
+    __m512d v = _mm512_setzero_pd();
+#else
+    f64x4 lo;
+    f64x4 hi;
+#endif
+
+    // ---- Constructors ----
+    static inline f64x8 broadcast(double x) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_set1_pd(x);
+        return r;
+#else
+        return {f64x4::broadcast(x), f64x4::broadcast(x)};
+#endif
+    }
+
+    static inline f64x8 zero() {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_setzero_pd();
+        return r;
+#else
+        return {f64x4::zero(), f64x4::zero()};
+#endif
+    }
+
+    // ---- Memory (unaligned) ----
+    static inline f64x8 load(const double* p) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_loadu_pd(p);
+        return r;
+#else
+        return {f64x4::load(p), f64x4::load(p + 4)};
+#endif
+    }
+
+    inline void store(double* p) const {
+#if F64X8_USE_AVX512
+        _mm512_storeu_pd(p, v);
+#else
+        lo.store(p);
+        hi.store(p + 4);
+#endif
+    }
+
+    // ---- Arithmetic ----
+    static inline f64x8 add(const f64x8& a, const f64x8& b) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_add_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x4::add(a.lo, b.lo), f64x4::add(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x8 sub(const f64x8& a, const f64x8& b) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_sub_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x4::sub(a.lo, b.lo), f64x4::sub(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x8 mul(const f64x8& a, const f64x8& b) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_mul_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x4::mul(a.lo, b.lo), f64x4::mul(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x8 div(const f64x8& a, const f64x8& b) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_div_pd(a.v, b.v);
+        return r;
+#else
+        return {f64x4::div(a.lo, b.lo), f64x4::div(a.hi, b.hi)};
+#endif
+    }
+
+    static inline f64x8 neg(const f64x8& a) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_sub_pd(_mm512_setzero_pd(), a.v);
+        return r;
+#else
+        return {f64x4::neg(a.lo), f64x4::neg(a.hi)};
+#endif
+    }
+
+    // ---- Scalar ops ----
+    static inline f64x8 mul_scalar(const f64x8& a, double s) {
+        return mul(a, broadcast(s));
+    }
+
+    static inline f64x8 div_scalar(const f64x8& a, double s) {
+        return div(a, broadcast(s));
+    }
+
+    // ---- Math functions ----
+    static inline f64x8 sqrt(const f64x8& a) {
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_sqrt_pd(a.v);
+        return r;
+#else
+        return {f64x4::sqrt(a.lo), f64x4::sqrt(a.hi)};
+#endif
+    }
+
+    // ---- FMA-style ----
+    static inline f64x8 madd(const f64x8& a, const f64x8& b, const f64x8& c) {
+        // a + b*c, rounded twice like f64x2::madd
+#if F64X8_USE_AVX512
+        f64x8 r;
+        r.v = _mm512_add_pd(a.v, _mm512_mul_pd(b.v, c.v));
+        return r;
+#else
+        return {f64x4::madd(a.lo, b.lo, c.lo), f64x4::madd(a.hi, b.hi, c.hi)};
+#endif
+    }
+
+    // ---- Printing ----
+    friend std::ostream& operator<<(std::ostream& os, const f64x8& f) {
+        alignas(64) double buf[LANES];
+        f.store(buf);
+        os << "(";
+        for (std::size_t i = 0; i < LANES; i++) {
+            os << (i ? ", " : "") << buf[i];
+        }
+        os << ")";
+        return os;
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include "util/vec/avx512.hpp"
+
+#include <cstddef>
+
+// Widest vector of doubles the target supports natively, chosen at compile time. Meant for
+// elementwise loops over flat arrays, where the width does not change the results.
+#if F64X8_USE_AVX512
+using f64v = f64x8;
+#elif F64X4_USE_AVX2
+using f64v = f64x4;
+#else
+using f64v = f64x2;
+#endif
+
+// dst[i] += src[i]
+inline void add_f64(double* dst, const double* src, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + f64v::LANES <= n; i += f64v::LANES) {
+        f64v::add(f64v::load(dst + i), f64v::load(src + i)).store(dst + i);
+    }
+    for (; i < n; i++) {
+        dst[i] += src[i];
+    }
+}
+
+// dst[i] += weight * src[i]
+inline void madd_f64(double* dst, double weight, const double* src, std::size_t n) {
+    const f64v w = f64v::broadcast(weight);
+
+    std::size_t i = 0;
+    for (; i + f64v::LANES <= n; i += f64v::LANES) {
+        f64v::madd(f64v::load(dst + i), w, f64v::load(src + i)).store(dst + i);
+    }
+    for (; i < n; i++) {
+        dst[i] += weight * src[i];
+    }
+}
@@ -12,6 +12,8 @@
 #endif
 
 struct f64x2 {
+    static constexpr std::size_t LANES = 2;
+
 #if F64X2_USE_SSE2
     __m128d v = _mm_setzero_pd();
 #else
@@ -50,6 +52,26 @@ struct f64x2 {
 #endif
     }
 
+    // ---- Memory (unaligned) ----
+    static inline f64x2 load(const double* p) {
+#if F64X2_USE_SSE2
+        f64x2 r;
+        r.v = _mm_loadu_pd(p);
+        return r;
+#else
+        return {p[0], p[1]};
+#endif
+    }
+
+    inline void store(double* p) const {
+#if F64X2_USE_SSE2
+        _mm_storeu_pd(p, v);
+#else
+        p[0] = lo;
+        p[1] = hi;
+#endif
+    }
+
     // ---- Extract ----
     inline double first() const {
 #if F64X2_USE_SSE2
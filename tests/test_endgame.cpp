@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include "endgame.hpp"
+#include "evaluation.hpp"
+#include "position.hpp"
+#include "test.hpp"
+#include "zobrist.hpp"
+
+using namespace Clockwork;
+
+struct EndgameCase {
+    std::string_view fen;
+    Endgame::EvalFn  fn;
+    Color            strong_side;
+    bool             win;
+};
+
+// Checks the evaluator matched for the position and the score it gives, both directly and
+// through the regular eval, which must hand the position over to it.
+Value check_endgame(const EndgameCase& c) {
+    std::cout << c.fen << std::endl;
+
+    Position       pos   = *Position::parse(c.fen);
+    Endgame::Match match = Endgame::find(pos.get_material_key());
+    REQUIRE(match.fn == c.fn);
+    REQUIRE(match.strong_side == c.strong_side);
+
+    Value score = match.fn(pos, match.strong_side);
+    if (c.win) {
+        REQUIRE(score >= Endgame::KNOWN_WIN);
+        REQUIRE(score < VALUE_WIN);
+    } else {
+        REQUIRE(score == 0);
+    }
+
+    Value white_eval = static_cast<Value>(evaluate_white_pov(pos));
+    REQUIRE(white_eval == (c.strong_side == Color::White ? score : -score));
+    return score;
+}
+
+void kpk() {
+    std::cout << "kpk" << std::endl;
+
+    std::vector<EndgameCase> cases{{
+      // King on the sixth in front of its pawn wins with either side to move
+      {"4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", Endgame::evaluate_kpk, Color::White, true},
+      {"4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", Endgame::evaluate_kpk, Color::White, true},
+      // Opposition: with black to move it is stalemate, with white to move the king steps aside
+      {"4k3/4P3/4K3/8/8/8/8/8 w - - 0 1", Endgame::evaluate_kpk, Color::White, true},
+      {"4k3/4P3/4K3/8/8/8/8/8 b - - 0 1", Endgame::evaluate_kpk, Color::White, false},
+      // The same positions with colors swapped
+      {"8/8/8/8/8/4k3/4p3/4K3 b - - 0 1", Endgame::evaluate_kpk, Color::Black, true},
+      {"8/8/8/8/8/4k3/4p3/4K3 w - - 0 1", Endgame::evaluate_kpk, Color::Black, false},
+      // Rook pawns are drawn once the defending king reaches the corner
+      {"k7/8/8/P7/8/8/8/1K6 w - - 0 1", Endgame::evaluate_kpk, Color::White, false},
+      {"k7/8/8/P7/8/8/8/1K6 b - - 0 1", Endgame::evaluate_kpk, Color::White, false},
+      {"8/8/8/8/p7/8/8/K1k5 w - - 0 1", Endgame::evaluate_kpk, Color::Black, false},
+      {"7k/8/8/7P/8/8/8/6K1 b - - 0 1", Endgame::evaluate_kpk, Color::White, false},
+      // ... but still win when the defending king is outside the square of the pawn
+      {"8/8/8/8/P7/8/8/K6k w - - 0 1", Endgame::evaluate_kpk, Color::White, true},
+      {"8/8/8/8/P7/8/8/K6k b - - 0 1", Endgame::evaluate_kpk, Color::White, true},
+      // An undefended pawn next to the defending king is lost with the defender to move
+      {"8/8/8/8/8/8/3kP3/K7 b - - 0 1", Endgame::evaluate_kpk, Color::White, false},
+    }};
+
+    for (const EndgameCase& c : cases) {
+        check_endgame(c);
+    }
+
+    // Pawns further up the board score higher
+    Value rank5 = check_endgame(cases[0]);
+    Value rank7 = check_endgame(cases[2]);
+    REQUIRE(rank7 > rank5);
+}
+
+void kbnk() {
+    std::cout << "kbnk" << std::endl;
+
+    // A light-squared bishop mates in a8 or h1, so those corners score higher than a1 or h8
+    Value right_corner = check_endgame(
+      {"k7/8/8/8/8/8/8/1BN1K3 w - - 0 1", Endgame::evaluate_kbnk, Color::White, true});
+    Value wrong_corner = check_endgame(
+      {"8/8/8/8/8/8/8/kBN1K3 w - - 0 1", Endgame::evaluate_kbnk, Color::White, true});
+    Value center = check_endgame(
+      {"8/8/8/3k4/8/8/8/1BN1K3 w - - 0 1", Endgame::evaluate_kbnk, Color::White, true});
+    REQUIRE(right_corner > wrong_corner);
+    REQUIRE(right_corner > center);
+
+    check_endgame({"1bn1k3/8/8/8/3K4/8/8/8 b - - 0 1", Endgame::evaluate_kbnk, Color::Black, true});
+}
+
+void kxk() {
+    std::cout << "kxk" << std::endl;
+
+    // The weak king is driven to the edge
+    Value edge = check_endgame(
+      {"3k4/8/3K4/8/8/8/8/R7 w - - 0 1", Endgame::evaluate_kxk, Color::White, true});
+    Value center = check_endgame(
+      {"8/8/3K4/8/3k4/8/8/R7 w - - 0 1", Endgame::evaluate_kxk, Color::White, true});
+    REQUIRE(edge > center);
+
+    // Extra material keeps being preferred
+    Value rook = check_endgame(
+      {"8/8/8/3k4/8/8/8/R3K3 w - - 0 1", Endgame::evaluate_kxk, Color::White, true});
+    Value queen = check_endgame(
+      {"8/8/8/3k4/8/8/8/Q3K3 w - - 0 1", Endgame::evaluate_kxk, Color::White, true});
+    REQUIRE(queen > rook);
+
+    check_endgame({"r3k3/8/8/8/3K4/8/8/8 w - - 0 1", Endgame::evaluate_kxk, Color::Black, true});
+    check_endgame({"4k3/8/8/8/8/8/P7/R3K3 b - - 0 1", Endgame::evaluate_kxk, Color::White, true});
+}
+
+void no_match() {
+    std::cout << "no_match" << std::endl;
+
+    std::vector<std::string_view> cases{{
+      "8/8/8/3k4/8/8/8/R3K2r w - - 0 1",    // KRKR
+      "8/8/8/3k4/8/8/8/N3K3 w - - 0 1",     // KNK
+      "8/8/8/3k4/8/8/8/B3K3 w - - 0 1",     // KBK
+      "8/8/8/3k4/8/8/4PP2/4K3 w - - 0 1",   // KPPK
+      "8/8/8/3k4/8/8/4p3/1B2K3 w - - 0 1",  // KBKP
+    }};
+
+    for (std::string_view fen : cases) {
+        std::cout << fen << std::endl;
+        Position pos = *Position::parse(fen);
+        REQUIRE(Endgame::find(pos.get_material_key()).fn == nullptr);
+    }
+}
+
+int main() {
+    Zobrist::init_zobrist_keys();
+    Endgame::init();
+    g_frc = false;
+
+    kpk();
+    kbnk();
+    kxk();
+    no_match();
+    return 0;
+}
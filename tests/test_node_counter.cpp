@@ -0,0 +1,113 @@
+#include "test.hpp"
+#include "util/node_counter.hpp"
+#include "util/types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace Clockwork;
+
+constexpr u64 NODES_PER_THREAD = u64{1} << 22;
+
+// Stand-in for the work done at a node, so the counting loop cannot be folded away.
+static u64 fake_node(u64 state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+struct alignas(64) AtomicCounter {
+    std::atomic<u64> value{0};
+};
+
+// Counts NODES_PER_THREAD nodes on every thread while another thread keeps polling the totals,
+// the way the UCI thread does during a search. Returns the elapsed time in nanoseconds.
+template<typename Count, typename Poll>
+static f64 run(usize thread_count, Count count, Poll poll) {
+    std::atomic<bool>        done{false};
+    std::atomic<u64>         sink{0};
+    std::vector<std::thread> threads;
+
+    std::thread poller{[&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            sink.fetch_add(poll(), std::memory_order_relaxed);
+        }
+    }};
+
+    auto start = std::chrono::steady_clock::now();
+    for (usize i = 0; i < thread_count; i++) {
+        threads.emplace_back([&, i] {
+            u64 state = i + 1;
+            for (u64 n = 0; n < NODES_PER_THREAD; n++) {
+                state = fake_node(state);
+                count(i);
+            }
+            sink.fetch_add(state, std::memory_order_relaxed);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    done = true;
+    poller.join();
+
+    return static_cast<f64>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+int main() {
+    usize thread_count = std::max(1u, std::thread::hardware_concurrency());
+    f64   total_nodes  = static_cast<f64>(thread_count * NODES_PER_THREAD);
+
+    auto atomic_counters = std::make_unique<AtomicCounter[]>(thread_count);
+    f64  atomic_ns       = run(
+      thread_count,
+      [&](usize i) {
+          atomic_counters[i].value.fetch_add(1, std::memory_order_relaxed);
+      },
+      [&] {
+          u64 nodes = 0;
+          for (usize i = 0; i < thread_count; i++) {
+              nodes += atomic_counters[i].value.load(std::memory_order_relaxed);
+          }
+          return nodes;
+      });
+
+    auto local_counters = std::make_unique<NodeCounter[]>(thread_count);
+    f64  local_ns       = run(
+      thread_count,
+      [&](usize i) {
+          local_counters[i].increment();
+      },
+      [&] {
+          u64 nodes = 0;
+          for (usize i = 0; i < thread_count; i++) {
+              nodes += local_counters[i].published();
+          }
+          return nodes;
+      });
+
+    // Published totals are exact once every thread has flushed its counter.
+    u64 nodes = 0;
+    for (usize i = 0; i < thread_count; i++) {
+        REQUIRE(local_counters[i].local() == NODES_PER_THREAD);
+        local_counters[i].publish();
+        nodes += local_counters[i].published();
+    }
+    REQUIRE(nodes == thread_count * NODES_PER_THREAD);
+
+    std::cout << "Threads: " << thread_count << std::endl;
+    std::cout << "Atomic fetch_add: " << static_cast<u64>(total_nodes * 1e9 / atomic_ns) << " nps"
+              << std::endl;
+    std::cout << "Thread-local counter: " << static_cast<u64>(total_nodes * 1e9 / local_ns)
+              << " nps" << std::endl;
+
+    return 0;
+}
@@ -6,12 +6,15 @@
 
 #include "perft.hpp"
 #include "position.hpp"
+#include "zobrist.hpp"
 #include <cstdlib>
 #include <iomanip>
 
 using namespace Clockwork;
 
 int main() {
+    Zobrist::init_zobrist_keys();
+
     std::vector<std::tuple<std::string_view, std::vector<u64>>> cases{{
       {
         "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
@@ -63,6 +66,15 @@ int main() {
                 std::exit(1);
             }
         }
+
+        // Split over threads with a shared perft hash, one depth short to keep the test quick
+        usize depth = results.size() - 2;
+        u64   value = perft(position, depth, PerftOptions{.threads = 4, .hash_mb = 16});
+        if (value != results[depth]) {
+            std::cout << "threads 4 hash 16: " << value << std::endl;
+            split_perft(position, depth, PerftOptions{.threads = 4, .hash_mb = 16});
+            std::exit(1);
+        }
     }
 
     return 0;
@@ -1,10 +1,13 @@
+#include <array>
 #include <iostream>
 #include <sstream>
 #include <string_view>
 #include <tuple>
 #include <vector>
 
+#include "movegen.hpp"
 #include "position.hpp"
+#include "see.hpp"
 #include "test.hpp"
 
 using namespace Clockwork;
@@ -88,9 +91,163 @@ void create_superpiece_mask() {
     REQUIRE(std::bit_cast<Wordboard>(expected_result) == wb);
 }
 
+void check_material_key(const Position& position, usize depth) {
+    REQUIRE(position.get_material_key() == position.calc_material_key_slow());
+
+    if (depth == 0) {
+        return;
+    }
+
+    MoveList noisy, quiet;
+    MoveGen  movegen{position};
+    movegen.generate_moves(noisy, quiet);
+    for (Move m : noisy) {
+        check_material_key(position.move(m), depth - 1);
+    }
+    for (Move m : quiet) {
+        check_material_key(position.move(m), depth - 1);
+    }
+}
+
+void incremental_material_key() {
+    std::vector<std::string_view> cases{{
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1R1K w kq - 0 1",
+      "8/2p5/3p4/KP5r/1R3pPk/8/4P3/8 b - g3 0 1",
+      "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    }};
+
+    g_frc = false;
+
+    for (std::string_view fen : cases) {
+        check_material_key(*Position::parse(fen), 3);
+    }
+
+    Position startpos =
+      *Position::parse("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    REQUIRE(material_key_count(startpos.get_material_key(), Color::White, PieceType::Pawn) == 8);
+    REQUIRE(material_key_count(startpos.get_material_key(), Color::Black, PieceType::Queen) == 1);
+}
+
+void check_attack_summary(const Position& position, usize depth) {
+    const AttackSummary summary{position};
+    for (Color c : {Color::White, Color::Black}) {
+        const usize      ci = static_cast<usize>(c);
+        const Wordboard& wb = position.attack_table(c);
+        REQUIRE(summary.any[ci] == wb.get_attacked_bitboard());
+        REQUIRE(summary.any[ci] == position.attacked_by(c));
+        REQUIRE(summary.two_or_more[ci] == position.attacked_by_two_or_more(c));
+        for (PieceType pt : {PieceType::Pawn, PieceType::Knight, PieceType::Bishop, PieceType::Rook,
+                             PieceType::Queen, PieceType::King}) {
+            REQUIRE(summary.by_pt[ci][static_cast<usize>(pt)]
+                    == wb.get_piece_mask_bitboard(position.piece_list(c).mask_eq(pt)));
+            REQUIRE(summary.by_pt[ci][static_cast<usize>(pt)] == position.attacked_by(c, pt));
+        }
+        for (u8 raw = 0; raw < 64; raw++) {
+            Square sq = Square{raw};
+            REQUIRE(summary.two_or_more[ci].is_set(sq) == (wb.read(sq).popcount() >= 2));
+        }
+    }
+
+    if (depth == 0) {
+        return;
+    }
+
+    MoveList noisy, quiet;
+    MoveGen  movegen{position};
+    movegen.generate_moves(noisy, quiet);
+    for (MoveList* moves : {&noisy, &quiet}) {
+        for (Move m : *moves) {
+            // SEE with the summary's shortcut must agree with the full exchange
+            for (Value threshold : {-500, -100, 0, 1, 100, 300, 500}) {
+                REQUIRE(SEE::see(position, m, threshold)
+                        == SEE::see(position, m, threshold, summary));
+            }
+            check_attack_summary(position.move(m), depth - 1);
+        }
+    }
+    check_attack_summary(position.null_move(), 0);
+}
+
+void attack_summary() {
+    std::vector<std::string_view> cases{{
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1R1K w kq - 0 1",
+      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "3r3k/3r4/8/3p4/2B5/3R4/3Q4/3K4 w - - 0 1",
+      "8/2p5/3p4/KP5r/1R3pPk/8/4P3/8 b - g3 0 1",
+    }};
+
+    g_frc = false;
+
+    for (std::string_view fen : cases) {
+        check_attack_summary(*Position::parse(fen), 2);
+    }
+}
+
+void check_packed_roundtrip(const Position& position, usize depth) {
+    PackedPosition packed   = position.pack();
+    auto           unpacked = Position::unpack(packed);
+    REQUIRE(unpacked.has_value());
+    REQUIRE(unpacked->pack() == packed);
+
+    // Piece ids depend on move history, so compare everything else
+    std::ostringstream expected, actual;
+    expected << position;
+    actual << *unpacked;
+    REQUIRE(expected.str() == actual.str());
+    REQUIRE(unpacked->get_hash_key() == position.get_hash_key());
+
+    // Attack tables are built per piece on unpack, so check them against a full scan
+    Position                 rescanned = *unpacked;
+    std::array<Wordboard, 2> tables    = {unpacked->attack_table(Color::White),
+                                          unpacked->attack_table(Color::Black)};
+    REQUIRE(rescanned.calc_attacks_slow() == tables);
+
+    if (depth == 0) {
+        return;
+    }
+
+    MoveList noisy, quiet;
+    MoveGen  movegen{position};
+    movegen.generate_moves(noisy, quiet);
+    for (Move m : noisy) {
+        check_packed_roundtrip(position.move(m), depth - 1);
+    }
+    for (Move m : quiet) {
+        check_packed_roundtrip(position.move(m), depth - 1);
+    }
+}
+
+void roundtrip_packed_positions() {
+    std::vector<std::string_view> cases{{
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1R1K w kq - 0 1",
+      "8/2p5/3p4/KP5r/1R3pPk/8/4P3/8 b - g3 0 1",
+      "r4rk1/1Bp1qppp/2np1n2/1pb1p1B1/4P1b1/P1NP1N2/1PP1QPPP/R4RK1 b - b6 1 11",
+      "2r1kr2/8/8/8/8/8/8/1R2K1R1 w GBfc - 0 1",
+      "2r3kr/8/8/8/8/8/8/2KRR3 w h - 3 2",
+    }};
+
+    g_frc = true;
+
+    for (std::string_view fen : cases) {
+        Position position = *Position::parse(fen);
+
+        // Parsed positions come back identical, piece ids included
+        REQUIRE(Position::unpack(position.pack()) == position);
+
+        check_packed_roundtrip(position, 2);
+    }
+
+    // Malformed records are rejected
+    PackedPosition no_kings{};
+    REQUIRE(!Position::unpack(no_kings));
+}
+
 int main() {
     roundtrip_classical_fens();
     roundtrip_dfrc_fens();
     create_superpiece_mask();
+    incremental_material_key();
+    attack_summary();
+    roundtrip_packed_positions();
     return 0;
 }
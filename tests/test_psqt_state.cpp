@@ -0,0 +1,96 @@
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "movegen.hpp"
+#include "position.hpp"
+#include "psqt_state.hpp"
+#include "test.hpp"
+#include "zobrist.hpp"
+
+using namespace Clockwork;
+
+// Brings the top of the stack up to date and checks it against a state built from scratch.
+void check_materialized(std::vector<PsqtState>& states,
+                        const Position&         pos,
+                        PsqtRefreshCache&       cache) {
+    PsqtState::materialize(states, pos, cache);
+    REQUIRE(states.back().score() == PsqtState{pos}.score());
+}
+
+void king_side_changes() {
+    std::cout << "king_side_changes" << std::endl;
+
+    // The kings keep crossing between the d and e files, while pawn moves and captures in
+    // between change the pieces each cached bucket was last computed from.
+    Position position = *Position::parse("4k3/1pp2pp1/3q4/8/3P4/2N5/1PP2PP1/4K3 w - - 0 1");
+
+    std::vector<std::string_view> moves{{
+      "e1d1", "e8d8", "d1e1", "d8e8", "b2b4", "e8d8", "e1d1", "d6b4", "d1e1", "d8e8", "d4d5",
+      "e8d8", "e1d1", "b4c3", "d1e2", "d8e8", "e2f1", "c3c2", "f1e1", "e8d8", "g2g4", "c2c1",
+      "e1e2", "d8e8", "e2d3", "c1a3", "d3c4", "e8d8", "c4d4", "a3a1", "d4e4", "d8e8",
+    }};
+
+    std::vector<PsqtState> states{PsqtState{position}};
+    PsqtRefreshCache       cache;
+
+    for (std::string_view movestr : moves) {
+        Move move = Move::parse(movestr, position).value();
+        states.push_back(states.back());
+        position = position.move(move, states.back(), nullptr);
+        check_materialized(states, position, cache);
+    }
+}
+
+void random_walk() {
+    std::cout << "random_walk" << std::endl;
+
+    std::vector<std::string_view> cases{{
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1R1K w kq - 0 1",
+      "8/2p5/3p4/KP5r/1R3pPk/8/4P3/8 b - - 0 1",
+      "3k4/2q2p2/8/8/8/8/2P2Q2/4K3 w - - 0 1",
+    }};
+
+    std::mt19937 rng{12345};
+
+    for (std::string_view fen : cases) {
+        std::vector<Position>  positions{*Position::parse(fen)};
+        std::vector<PsqtState> states{PsqtState{positions.back()}};
+        PsqtRefreshCache       cache;
+
+        // Plays random moves and unwinds now and then like a search would, only materializing
+        // some of the states so that several deferred moves are applied at once.
+        for (usize step = 0; step < 2000; step++) {
+            MoveList noisy, quiet;
+            MoveGen  movegen{positions.back()};
+            movegen.generate_moves(noisy, quiet);
+
+            const usize move_count = noisy.size() + quiet.size();
+            if (move_count == 0 || positions.size() > 16 || rng() % 4 == 0) {
+                if (positions.size() > 1) {
+                    positions.pop_back();
+                    states.pop_back();
+                }
+            } else {
+                const usize idx  = rng() % move_count;
+                const Move  move = idx < noisy.size() ? noisy[idx] : quiet[idx - noisy.size()];
+                states.push_back(states.back());
+                positions.push_back(positions.back().move(move, states.back(), nullptr));
+            }
+
+            if (rng() % 3 == 0) {
+                check_materialized(states, positions.back(), cache);
+            }
+        }
+    }
+}
+
+int main() {
+    Zobrist::init_zobrist_keys();
+    g_frc = false;
+
+    king_side_changes();
+    random_walk();
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "cuckoo.hpp"
+#include "endgame.hpp"
+#include "position.hpp"
+#include "repetition_info.hpp"
+#include "search.hpp"
+#include "test.hpp"
+#include "util/types.hpp"
+#include "zobrist.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+using namespace Clockwork;
+using Clock = std::chrono::steady_clock;
+
+constexpr usize GO_ITERATIONS   = 200;
+constexpr usize STOP_ITERATIONS = 50;
+
+// Far longer than any launch or stop should take, even on a loaded machine
+constexpr auto DEADLINE = std::chrono::seconds(10);
+
+struct Latency {
+    f64 average_us = 0;
+    f64 max_us     = 0;
+};
+
+static Latency summarize(const std::vector<Clock::duration>& samples) {
+    Latency result;
+    for (Clock::duration sample : samples) {
+        f64 us = std::chrono::duration<f64, std::micro>(sample).count();
+        result.average_us += us / static_cast<f64>(samples.size());
+        result.max_us = std::max(result.max_us, us);
+    }
+    return result;
+}
+
+// Fails the test when a search is still running DEADLINE after being armed, so that a lost wake
+// or stop is reported instead of leaving the test to hang. It only polls every 100 ms to keep out
+// of the measurements.
+class Watchdog {
+public:
+    Watchdog() :
+        m_thread{[this](std::stop_token stop) {
+            run(stop);
+        }} {
+    }
+
+    void arm() {
+        m_armed_at.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    void disarm() {
+        m_armed_at.store(DISARMED, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr Clock::rep DISARMED = std::numeric_limits<Clock::rep>::max();
+
+    std::atomic<Clock::rep> m_armed_at = DISARMED;
+    std::jthread            m_thread;
+
+    void run(std::stop_token stop) {
+        while (!stop.stop_requested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            Clock::rep armed_at = m_armed_at.load(std::memory_order_relaxed);
+            REQUIRE(armed_at == DISARMED
+                    || Clock::now() - Clock::time_point{Clock::duration{armed_at}} < DEADLINE);
+        }
+    }
+};
+
+// Time from launching a search until every worker has picked it up, using tiny depth 1
+// searches like a `go depth 1` loop would. Every search must end on its own with a bestmove.
+static Latency go_latency(Search::Searcher& searcher, Watchdog& watchdog) {
+    Search::SearchSettings settings = {.depth = 1, .silent = true};
+
+    std::vector<Clock::duration> samples;
+    for (usize i = 0; i < GO_ITERATIONS; i++) {
+        watchdog.arm();
+        auto start = Clock::now();
+        searcher.launch_search(settings);
+        samples.push_back(Clock::now() - start);
+        Search::SearchResult result = searcher.wait_for_result();
+        watchdog.disarm();
+        REQUIRE(result.best_move != Move::none());
+    }
+    return summarize(samples);
+}
+
+// Time from stopping an unbounded search until every worker has returned. Without limits, only
+// the stop can end the search.
+static Latency stop_latency(Search::Searcher& searcher, Watchdog& watchdog) {
+    Search::SearchSettings settings = {.silent = true};
+
+    std::vector<Clock::duration> samples;
+    for (usize i = 0; i < STOP_ITERATIONS; i++) {
+        watchdog.arm();
+        searcher.launch_search(settings);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+        auto start = Clock::now();
+        searcher.stop_searching();
+        Search::SearchResult result = searcher.wait_for_result();
+        samples.push_back(Clock::now() - start);
+        watchdog.disarm();
+        REQUIRE(result.best_move != Move::none());
+    }
+    return summarize(samples);
+}
+
+int main() {
+    Zobrist::init_zobrist_keys();
+    Cuckoo::init();
+    Endgame::init();
+
+    Position startpos =
+      *Position::parse("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    RepetitionInfo repetition_info;
+
+    Search::Searcher searcher;
+    Watchdog         watchdog;
+    for (usize threads : {1, 2, 4, 8}) {
+        searcher.initialize(threads);
+        searcher.set_position(startpos, repetition_info);
+
+        Latency go   = go_latency(searcher, watchdog);
+        Latency stop = stop_latency(searcher, watchdog);
+
+        std::cout << "Threads " << threads << ": go->start " << go.average_us << " us avg "
+                  << go.max_us << " us max, stop->bestmove " << stop.average_us << " us avg "
+                  << stop.max_us << " us max" << std::endl;
+    }
+
+    return 0;
+}
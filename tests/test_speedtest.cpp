@@ -1,3 +1,5 @@
+#include "cuckoo.hpp"
+#include "endgame.hpp"
 #include "search.hpp"
 #include "speedtest.hpp"
 #include "zobrist.hpp"
@@ -6,7 +8,9 @@ using namespace Clockwork;
 
 int main() {
     Zobrist::init_zobrist_keys();
+    Cuckoo::init();
+    Endgame::init();
     Search::Searcher searcher;
-    Speedtest::speedtest(searcher);
+    Speedtest::run_speedtest(searcher);
     return 0;
 }
@@ -0,0 +1,201 @@
+#include "cuckoo.hpp"
+#include "endgame.hpp"
+#include "position.hpp"
+#include "repetition_info.hpp"
+#include "search.hpp"
+#include "test.hpp"
+#include "tt.hpp"
+#include "util/types.hpp"
+#include "zobrist.hpp"
+#include <array>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Clockwork;
+
+constexpr usize RANDOM_CLUSTERS = 4096;
+
+static u64 next_random(u64& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+template<usize ENTRIES>
+using Words = std::array<u64, TTClusterMemory<ENTRIES>::WORDS>;
+
+template<usize ENTRIES>
+static Words<ENTRIES> cluster_words(const TranspositionTable<ENTRIES>& tt, u64 key) {
+    return std::bit_cast<Words<ENTRIES>>(tt.addr_key(key)->load());
+}
+
+// Every cluster we wrote must read back identically from the loaded table.
+template<usize ENTRIES>
+static void require_same(const TranspositionTable<ENTRIES>& expected,
+                         const TranspositionTable<ENTRIES>& actual) {
+    REQUIRE(expected.size_bytes() == actual.size_bytes());
+    REQUIRE(expected.hashfull() == actual.hashfull());
+
+    u64 state = 1;
+    for (usize i = 0; i < RANDOM_CLUSTERS; i++) {
+        u64 key = next_random(state);
+        next_random(state);
+        REQUIRE(cluster_words(expected, key) == cluster_words(actual, key));
+    }
+}
+
+static void flip_byte(const std::string& path, std::streamoff offset) {
+    std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+    file.seekg(offset);
+    char byte = 0;
+    file.read(&byte, 1);
+    byte = static_cast<char>(byte ^ 0x5A);
+    file.seekp(offset);
+    file.write(&byte, 1);
+}
+
+// Byte offset of entries_per_cluster in the hash file header
+constexpr std::streamoff ENTRIES_PER_CLUSTER_OFFSET = 33;
+
+static void set_entries_per_cluster(const std::string& path, u8 entries) {
+    std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+    file.seekp(ENTRIES_PER_CLUSTER_OFFSET);
+    file.write(reinterpret_cast<const char*>(&entries), 1);
+}
+
+template<usize ENTRIES>
+static void test_layout() {
+    using Table = TranspositionTable<ENTRIES>;
+
+    const std::string path =
+      (std::filesystem::temp_directory_path() / "clockwork_test_tt_persistence.hash").string();
+
+    Table original{2};
+    original.increment_age();
+
+    // Real entries, so that probing goes through the usual path too
+    std::vector<Position> positions;
+    for (std::string_view fen : {
+           "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+           "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+           "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+         }) {
+        positions.push_back(*Position::parse(fen));
+        original.store(positions.back(), 0, 17, Move::none(), 42, 9, true, Bound::Exact);
+    }
+
+    // And arbitrary cluster contents, to catch anything lost in the raw copy
+    u64 state = 1;
+    for (usize i = 0; i < RANDOM_CLUSTERS; i++) {
+        u64 key = next_random(state);
+        u64 raw = next_random(state);
+
+        Words<ENTRIES> words;
+        for (usize w = 0; w < words.size(); w++) {
+            words[w] = raw * (2 * w + 1);
+        }
+        original.addr_key(key)->store(std::bit_cast<typename Table::Cluster>(words));
+    }
+
+    REQUIRE(original.save(path) == TTFileStatus::Ok);
+
+    for (bool map : {false, true}) {
+        Table loaded{1};
+        REQUIRE(loaded.load(path, map) == TTFileStatus::Ok);
+        require_same(original, loaded);
+
+        // The loaded table must remain writable, including when it is mapped from the file
+        loaded.store(positions[0], 0, -5, Move::none(), -12, 50, false, Bound::Exact);
+        REQUIRE(loaded.probe(positions[0], 0)->score == -12);
+    }
+
+    // Writes to a mapped table never reach the file
+    Table reloaded{1};
+    REQUIRE(reloaded.load(path, false) == TTFileStatus::Ok);
+    require_same(original, reloaded);
+
+    // Saving over the file a table is mapped from leaves that table usable
+    Table mapped{1};
+    REQUIRE(mapped.load(path, true) == TTFileStatus::Ok);
+    REQUIRE(mapped.save(path) == TTFileStatus::Ok);
+    require_same(original, mapped);
+    mapped.store(positions[1], 0, 33, Move::none(), 7, 12, false, Bound::Lower);
+    REQUIRE(mapped.probe(positions[1], 0)->score == 7);
+    REQUIRE(!std::filesystem::exists(path + ".tmp"));
+
+    // Corruption is detected, and the current table is kept
+    flip_byte(path, 64 + 1000);
+    Table kept{1};
+    REQUIRE(kept.load(path, false) == TTFileStatus::ChecksumMismatch);
+    REQUIRE(kept.load(path, true) == TTFileStatus::ChecksumMismatch);
+    REQUIRE(kept.size_bytes() == 1024 * 1024);
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+    REQUIRE(kept.load(path, false) == TTFileStatus::SizeMismatch);
+
+    flip_byte(path, 0);
+    REQUIRE(kept.load(path, false) == TTFileStatus::BadHeader);
+
+    REQUIRE(kept.load(path + ".missing", false) == TTFileStatus::OpenFailed);
+
+    std::filesystem::remove(path);
+}
+
+// loadhash <file> mmap, savehash <file>, go: the search runs on the table mapped from the file
+// that was just replaced.
+static void search_after_saving_over_mapped_table() {
+    const std::string path =
+      (std::filesystem::temp_directory_path() / "clockwork_test_tt_search.hash").string();
+
+    Search::Searcher searcher;
+    searcher.initialize(1);
+    searcher.set_position(
+      *Position::parse("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"),
+      RepetitionInfo{});
+
+    Search::SearchSettings settings = {.depth = 8, .silent = true};
+    searcher.launch_search(settings);
+    searcher.wait();
+
+    REQUIRE(searcher.tt.save(path) == TTFileStatus::Ok);
+    REQUIRE(searcher.tt.load(path, true) == TTFileStatus::Ok);
+    REQUIRE(searcher.tt.save(path) == TTFileStatus::Ok);
+
+    settings.depth = 10;
+    searcher.launch_search(settings);
+    searcher.wait();
+
+    std::filesystem::remove(path);
+}
+
+int main() {
+    Zobrist::init_zobrist_keys();
+    Cuckoo::init();
+    Endgame::init();
+
+    search_after_saving_over_mapped_table();
+
+    test_layout<3>();
+    test_layout<6>();
+
+    // A file written with one layout is not accepted by the other
+    const std::string path =
+      (std::filesystem::temp_directory_path() / "clockwork_test_tt_layouts.hash").string();
+    REQUIRE(TranspositionTable<3>{1}.save(path) == TTFileStatus::Ok);
+    TranspositionTable<6> other{1};
+    REQUIRE(other.load(path, false) == TTFileStatus::BadHeader);
+
+    // Neither is a file whose clusters have the same size but hold a different number of entries,
+    // as written by a build with 2 entries per cluster
+    set_entries_per_cluster(path, 2);
+    TranspositionTable<3> same_size{1};
+    REQUIRE(same_size.load(path, false) == TTFileStatus::BadHeader);
+    REQUIRE(same_size.load(path, true) == TTFileStatus::BadHeader);
+    std::filesystem::remove(path);
+
+    return 0;
+}